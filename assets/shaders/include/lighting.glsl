@@ -0,0 +1,18 @@
+// Iluminação do Sol nos planetas (textura comum e virtual).
+uniform vec3 lightPos;
+uniform vec3 viewPos;
+
+vec3 sunLighting(vec3 fragPos, vec3 normal)
+{
+    // Iluminação Ambiente (uma luz fraca para o lado escuro não ser totalmente preto)
+    float ambientStrength = 0.1;
+    vec3 ambient = ambientStrength * vec3(1.0, 1.0, 1.0);
+
+    // Iluminação Difusa (a luz direta do Sol que cria o "dia")
+    vec3 norm = normalize(normal);
+    vec3 lightDir = normalize(lightPos - fragPos);
+    float diff = max(dot(norm, lightDir), 0.0);
+    vec3 diffuse = diff * vec3(1.0, 1.0, 1.0);
+
+    return ambient + diffuse;
+}
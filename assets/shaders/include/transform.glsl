@@ -0,0 +1,20 @@
+// Matrizes das malhas (esfera e anel), todas calculadas na CPU por objeto:
+// nada de inverse() por vértice aqui.
+uniform mat4 model;
+uniform mat4 mvp;            // projection * view * model
+uniform mat3 normalMatrix;   // inversa transposta da parte 3x3 de model
+
+vec3 worldPosition(vec3 localPos)
+{
+    return vec3(model * vec4(localPos, 1.0));
+}
+
+vec3 worldNormal(vec3 localNormal)
+{
+    return normalMatrix * localNormal;
+}
+
+vec4 clipPosition(vec3 localPos)
+{
+    return mvp * vec4(localPos, 1.0);
+}
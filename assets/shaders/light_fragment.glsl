@@ -2,11 +2,23 @@
 out vec4 FragColor;
 
 in vec2 TexCoord;
+in vec3 LocalPos;
 
 uniform sampler2D ourTexture;
+uniform sampler3D noiseVolume;   // fBm periódico (ladrilha com GL_REPEAT)
+uniform float noiseStrength;     // 0 enquanto o volume não chegou
+uniform float time;
 
 void main()
 {
     // O Sol não é afetado pela luz, ele simplesmente usa a cor da sua própria textura.
-    FragColor = texture(ourTexture, TexCoord);
+    vec4 base = texture(ourTexture, TexCoord);
+
+    // Granulação: duas leituras do volume em escalas diferentes, deslizando em
+    // direções opostas; a diferença entre elas faz as células "ferverem".
+    float a = texture(noiseVolume, LocalPos * 1.5 + vec3(0.011, 0.007, 0.0) * time).r;
+    float b = texture(noiseVolume, LocalPos * 3.7 - vec3(0.0, 0.013, 0.009) * time).r;
+    float granulation = (a * 0.6 + b * 0.4) * 2.0 - 1.0;
+
+    FragColor = vec4(base.rgb * (1.0 + 0.35 * noiseStrength * granulation), base.a);
 }
\ No newline at end of file
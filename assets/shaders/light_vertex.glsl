@@ -3,13 +3,13 @@ layout (location = 0) in vec3 aPos;
 layout (location = 2) in vec2 aTexCoord; // Vamos usar o mesmo VAO da esfera
 
 out vec2 TexCoord;
+out vec3 LocalPos;   // posição na esfera unitária: coordenada do volume de ruído
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#include "include/transform.glsl"
 
 void main()
 {
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    gl_Position = clipPosition(aPos);
     TexCoord = aTexCoord;
+    LocalPos = aPos;
 }
\ No newline at end of file
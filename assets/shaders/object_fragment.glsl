@@ -5,23 +5,17 @@ in vec3 FragPos;
 in vec3 Normal;
 in vec2 TexCoord;
 
-uniform vec3 lightPos;
-uniform vec3 viewPos;
 uniform sampler2D ourTexture;
 
+#include "include/lighting.glsl"
+
 void main()
 {
-    // Iluminação Ambiente (uma luz fraca para o lado escuro não ser totalmente preto)
-    float ambientStrength = 0.1;
-    vec3 ambient = ambientStrength * vec3(1.0, 1.0, 1.0);
-
-    // Iluminação Difusa (a luz direta do Sol que cria o "dia")
-    vec3 norm = normalize(Normal);
-    vec3 lightDir = normalize(lightPos - FragPos);
-    float diff = max(dot(norm, lightDir), 0.0);
-    vec3 diffuse = diff * vec3(1.0, 1.0, 1.0);
-    
-    // Combina as luzes e aplica a textura
-    vec3 lighting = (ambient + diffuse);
-    FragColor = texture(ourTexture, TexCoord) * vec4(lighting, 1.0);
-}
\ No newline at end of file
+    vec4 base = texture(ourTexture, TexCoord);
+    vec3 lighting = sunLighting(FragPos, Normal);
+#ifdef ALPHA_BLEND
+    FragColor = vec4(base.rgb * lighting, base.a);   // anéis: o alfa da textura recorta as faixas
+#else
+    FragColor = vec4(base.rgb * lighting, 1.0);      // planetas opacos: desenhados com o blend desligado
+#endif
+}
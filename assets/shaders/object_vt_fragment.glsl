@@ -0,0 +1,41 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec3 FragPos;
+in vec3 Normal;
+in vec2 TexCoord;
+
+#include "include/lighting.glsl"
+
+// Textura virtual: a page table tem um texel por tile (RGBA8 = página x, página y,
+// nível realmente residente, válido) e aponta para o cache físico de páginas.
+uniform sampler2D pageTable;
+uniform sampler2D physTex;
+uniform vec2  vtSize;     // texels do nível 0
+uniform float vtLevels;   // 0 enquanto o page file não está aberto
+uniform vec3  vtPage;     // tile, borda, lado do cache físico (texels)
+
+vec4 sampleVirtual(vec2 uv)
+{
+    const vec4 placeholder = vec4(0.16, 0.16, 0.19, 1.0);
+    if (vtLevels < 1.0) return placeholder;
+    vec2 texel = clamp(uv, vec2(0.0), vec2(0.999999)) * vtSize;
+    vec2 dx = dFdx(texel), dy = dFdy(texel);
+    float lod = floor(0.5 * log2(max(max(dot(dx, dx), dot(dy, dy)), 1e-8)));
+    lod = clamp(lod, 0.0, vtLevels - 1.0);
+
+    ivec2 tile = ivec2(texel / (vtPage.x * exp2(lod)));
+    vec4 e = floor(texelFetch(pageTable, tile, int(lod)) * 255.0 + 0.5);
+    if (e.a == 0.0) return placeholder;
+
+    // Posição dentro do tile no nível que está de fato no cache (pode ser um ancestral)
+    vec2 levelTexel = texel / exp2(e.b);
+    vec2 inTile = levelTexel - floor(levelTexel / vtPage.x) * vtPage.x;
+    vec2 phys = (e.rg * (vtPage.x + 2.0 * vtPage.y) + vtPage.y + inTile) / vtPage.z;
+    return textureLod(physTex, phys, 0.0);
+}
+
+void main()
+{
+    FragColor = vec4(sampleVirtual(TexCoord).rgb * sunLighting(FragPos, Normal), 1.0);
+}
@@ -1,9 +1,9 @@
 #version 330 core
 out vec4 FragColor;
 
-in vec2 vUV;
-uniform sampler2D skyTex;
+in vec4 vWorld;
+uniform samplerCube skyTex;
 
 void main() {
-    FragColor = texture(skyTex, vUV);
+    FragColor = texture(skyTex, vWorld.xyz / vWorld.w);
 }
@@ -1,14 +1,11 @@
 #version 330 core
-layout (location = 0) in vec3 aPos;
-layout (location = 2) in vec2 aTex;
+// Triângulo de tela cheia sem buffers: gl_VertexID 0,1,2 -> (-1,-1) (3,-1) (-1,3)
+uniform mat4 invViewProj;   // inversa de projection * view (sem translação)
 
-uniform mat4 projection;
-uniform mat4 view;
-uniform mat4 model;
-
-out vec2 vUV;
+out vec4 vWorld;
 
 void main() {
-    vUV = aTex;
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    vec2 ndc = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2) * 2.0 - 1.0;
+    vWorld = invViewProj * vec4(ndc, 1.0, 1.0);   // ponto no plano far; w dividido no fragment
+    gl_Position = vec4(ndc, 1.0, 1.0);            // profundidade 1.0
 }
@@ -0,0 +1,24 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoord;
+
+// Passe de feedback: grava o tile que cada pixel precisa.
+// R/G = 8 bits baixos de x/y, B = nível * 16 + 2 bits altos de x e de y, A = id + 1
+uniform vec2  vtSize;
+uniform float vtLevels;
+uniform float vtTile;
+uniform float vtId;
+uniform float lodBias;    // -log2(divisor da resolução), para pedir o mesmo nível da tela cheia
+
+void main()
+{
+    vec2 texel = clamp(TexCoord, vec2(0.0), vec2(0.999999)) * vtSize;
+    vec2 dx = dFdx(texel), dy = dFdy(texel);
+    float lod = floor(0.5 * log2(max(max(dot(dx, dx), dot(dy, dy)), 1e-8)) + lodBias);
+    lod = clamp(lod, 0.0, vtLevels - 1.0);
+
+    vec2 tile = floor(texel / (vtTile * exp2(lod)));
+    vec2 hi = floor(tile / 256.0);
+    FragColor = vec4(tile - hi * 256.0, lod * 16.0 + hi.x * 4.0 + hi.y, vtId) / 255.0;
+}
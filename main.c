@@ -1,10 +1,81 @@
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <malloc.h>
+#else
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE   // O_DIRECT (e pread/posix_memalign sem depender de -std=gnu*)
+#endif
+#include <pthread.h>
+#include <unistd.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#endif
+#if defined(__linux__)
+#include <malloc.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#include <sys/inotify.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define USE_IO_URING 1
+#endif
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define USE_SSE2 1
+#include <emmintrin.h>
+#endif
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <cglm/cglm.h>
 #include <math.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#ifdef USE_LIBJPEG
+#include <setjmp.h>
+#include <jpeglib.h>
+#endif
+#ifdef USE_LIBPNG
+#include <png.h>
+#endif
 
+#if defined(_MSC_VER)
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL _Thread_local
+#endif
+
+// stb_image aloca na arena da thread que decodifica (decodeArenaBegin/End)
+void*  decodeAlloc(size_t size);
+void*  decodeRealloc(void* p, size_t size);
+void   decodeFree(void* p);
+void   decodeArenaBegin(void);
+size_t decodeArenaEnd(void);     // devolve o pico de bytes da decodificação
+unsigned char* decodeImage(const unsigned char* data, size_t size, int* w, int* h, int* n);   // backends em ordem; stb por último
+int            selectImageDecoder(const char* name);                                         // --decoder=<nome>
+
+// Imagem lida em faixas de linhas (page files das texturas virtuais). Com libjpeg o
+// JPEG é decodificado aos poucos; nos demais casos a imagem sai inteira do
+// decodeImage e só é percorrida em faixas.
+typedef struct ScanlineSource {
+    int w, h, n;
+    int flipped;   // linhas na ordem do arquivo; a imagem do jogo é a invertida (flip do stb)
+    const unsigned char* (*read)(struct ScanlineSource* src, int count);   // próximas 'count' linhas; NULL em erro
+    void (*close)(struct ScanlineSource* src);
+    unsigned char* pixels;   // imagem inteira (sem leitura incremental)
+    int   next;
+    void* state;
+} ScanlineSource;
+int openScanlines(const unsigned char* data, size_t size, ScanlineSource* out);   // 'data' válido até o close
+#define STBI_MALLOC(sz)     decodeAlloc(sz)
+#define STBI_REALLOC(p, sz) decodeRealloc(p, sz)
+#define STBI_FREE(p)        decodeFree(p)
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
@@ -41,9 +112,389 @@ void generateRing(float innerR, float outerR, int segments,
                   float** vertices, unsigned int* vertexCount,
                   unsigned int** indices, unsigned int* indexCount);
 
-char* loadShaderSource(const char* filePath);
-unsigned int createShaderProgram(const char* vertexPath, const char* fragmentPath);
-GLuint loadTexture2D(const char* path);
+unsigned int simplifyMesh(const float* vertices, unsigned int vertexCount,
+                          const unsigned int* indices, unsigned int indexCount,
+                          unsigned int targetIndexCount, unsigned int* outIndices, float* outError);
+
+// Programa compartilhado (acquireShaderProgram). 'id' muda quando o hot reload
+// troca o programa: leia a cada quadro em vez de guardar o número.
+typedef struct ShaderProgram {
+    unsigned int id;
+    int      refCount;
+    uint64_t contentKey;
+    char     vertexPath[256], fragmentPath[256];   // primeiro par que pediu o programa
+    char     defines[128];                         // variante ("" = básica)
+    struct ProgramBuild* pending;   // primeiro link ainda em andamento
+    struct ProgramBuild* reload;    // versão editada compilando em segundo plano
+    struct ShaderProgram* next;
+} ShaderProgram;
+
+unsigned int   createShaderProgram(const char* vertexPath, const char* fragmentPath);   // bloqueia até linkar; 0 sem fonte
+ShaderProgram* acquireShaderProgram(const char* vertexPath, const char* fragmentPath,   // compartilhado; uma variante
+                                    const char* defines);                               // por 'defines'; NULL sem fonte
+void           releaseShaderProgram(ShaderProgram* program);
+int            initProgramCache(void);            // depois do gladLoadGL; 0 se o driver não exporta binários
+int            initParallelShaderCompile(void);   // 0 sem KHR/ARB_parallel_shader_compile
+int            shaderProgramReady(unsigned int program);   // não bloqueia com compilação paralela
+int            startShaderHotReload(const char* dir);      // 1 = inotify, 0 = varredura periódica
+void           updateShaderHotReload(void);                // uma vez por quadro
+int benchBlockCompression(void);
+int benchMipmaps(void);
+int benchAsyncIO(void);
+int benchJpegDecode(void);
+int benchDecoders(void);
+int benchNoise(void);
+static const char* benchIoPath;     // --bench-io=<arquivo>
+static const char* benchJpegPath;   // --bench-jpeg=<arquivo> (além das texturas)
+
+// --- Threads (Win32 / POSIX) ---
+#ifdef _WIN32
+typedef HANDLE             Thread;
+typedef CRITICAL_SECTION   Mutex;
+typedef CONDITION_VARIABLE Cond;
+#else
+typedef pthread_t          Thread;
+typedef pthread_mutex_t    Mutex;
+typedef pthread_cond_t     Cond;
+#endif
+
+void threadStart(Thread* t, void (*fn)(void*), void* arg);
+void threadJoin(Thread t);
+void mutexInit(Mutex* m);
+void mutexDestroy(Mutex* m);
+void mutexLock(Mutex* m);
+void mutexUnlock(Mutex* m);
+void condInit(Cond* c);
+void condWait(Cond* c, Mutex* m);
+void condBroadcast(Cond* c);
+int  cpuCount(void);
+double nowSeconds(void);
+
+// --- Pool de workers (fila de jobs) ---
+#define POOL_MAX_THREADS 16
+#define POOL_QUEUE_MAX   256
+
+typedef void (*JobFn)(void* arg);
+typedef struct { JobFn fn; void* arg; } Job;
+
+typedef struct {
+    Thread threads[POOL_MAX_THREADS];
+    int    threadCount;
+    Job    queue[POOL_QUEUE_MAX];   // fila circular
+    int    head, count;
+    Mutex  lock;
+    Cond   changed;
+    int    quit;
+} JobPool;
+
+void jobPoolStart(JobPool* pool, int threadCount);
+void jobPoolSubmit(JobPool* pool, JobFn fn, void* arg);
+int  jobPoolTrySubmit(JobPool* pool, JobFn fn, void* arg);   // 0 = fila cheia, não enfileirou
+void jobPoolStop(JobPool* pool);
+
+// Divide [0, count) em faixas de 'grain' itens entre os workers; quem chama
+// também executa faixas, então pode ser usado de dentro de outro job.
+typedef void (*RangeFn)(void* ctx, int begin, int end);
+void parallelFor(JobPool* pool, int count, int grain, RangeFn fn, void* ctx);
+
+static JobPool workers;   // decodificação de imagens e demais tarefas de CPU
+static int texCompression;   // 1 = gerar/usar caches BC1/BC3 (driver com S3TC)
+
+typedef enum { MIP_FILTER_BOX, MIP_FILTER_KAISER, MIP_FILTER_LANCZOS } MipFilter;
+static MipFilter mipFilter = MIP_FILTER_KAISER;   // filtro dos mips gerados na CPU
+static const char* mipFilterNames[] = {"box", "kaiser", "lanczos"};
+void initColorLUTs(void);
+
+// --- Arquivos (mapeamento em memória, hash, diretórios) ---
+typedef struct {
+    const unsigned char* data;
+    size_t size;
+#ifdef _WIN32
+    HANDLE file, mapping;
+#endif
+} MappedFile;
+
+#define HASH_SEED 0xcbf29ce484222325ull   // FNV-1a 64
+
+int      mapFile(const char* path, MappedFile* out);
+void     unmapFile(MappedFile* mf);
+uint64_t hashBytes(const void* data, size_t size, uint64_t seed);
+int      makeDirs(const char* path);
+int      replaceFile(const char* from, const char* to);
+int      writeFileAtomic(const char* path, const void* data, size_t size);   // temporário + rename
+int      readFileAt(FILE* f, uint64_t offset, void* dst, size_t size);   // offsets de 64 bits
+int      writeFileAt(FILE* f, uint64_t offset, const void* src, size_t size);
+void     listFiles(const char* dir, void (*fn)(const char* path, void* ctx), void* ctx);   // recursivo
+uint64_t fileWriteTime(const char* path);   // última escrita, unidade do sistema; 0 se não existe
+
+// Tabela hash de recursos (chave de 64 bits -> ponteiro), endereçamento aberto.
+// Usada pelos caches de texturas, malhas e programas; a chave 0 é reservada.
+typedef struct { uint64_t key; void* value; } ResourceSlot;
+typedef struct {
+    ResourceSlot* slots;
+    uint32_t capacity, count;   // capacidade sempre potência de 2
+} ResourceMap;
+
+void* resourceFind(const ResourceMap* map, uint64_t key);
+void  resourceInsert(ResourceMap* map, uint64_t key, void* value);
+void  resourceRemove(ResourceMap* map, uint64_t key);
+void  resourceRemoveValue(ResourceMap* map, const void* value);   // todas as chaves de 'value'
+
+// --- E/S assíncrona (io_uring no Linux; threads de E/S como fallback) ---
+// Leituras posicionais em lote; cada pedido concluído vai para a IoQueue indicada.
+// Com O_DIRECT (ioOpen com direct = 1) offset, tamanho e destino precisam estar
+// alinhados em IO_ALIGN: use ioAllocAligned.
+#define IO_ALIGN        4096u
+#define IO_RING_ENTRIES 128   // SQ do io_uring (a CQ tem o dobro)
+#define IO_THREADS      4     // fallback: leituras bloqueantes simultâneas
+
+#ifdef _WIN32
+typedef HANDLE IoFile;
+#else
+typedef int    IoFile;
+#endif
+
+typedef enum { IO_BACKEND_THREADS, IO_BACKEND_URING } IoBackend;
+static const char* ioBackendNames[] = {"threads", "io_uring"};
+
+typedef struct IoRequest IoRequest;
+typedef struct {
+    Mutex      lock;
+    Cond       ready;
+    IoRequest *head, *tail;
+} IoQueue;
+
+struct IoRequest {
+    IoFile     file;
+    uint64_t   offset;
+    void*      dst;
+    uint32_t   size;
+    int32_t    result;   // bytes lidos ou -errno
+    IoQueue*   done;     // recebe o pedido concluído
+    IoRequest* next;     // uso interno das filas
+};
+
+IoBackend  ioStart(int allowUring);
+void       ioStop(void);
+int        ioOpen(const char* path, int direct, IoFile* out, uint64_t* size);   // 2 = com O_DIRECT
+void       ioClose(IoFile f);
+void       ioSubmit(IoRequest** requests, int count);
+void       ioQueueInit(IoQueue* q);
+IoRequest* ioQueuePop(IoQueue* q, int wait);   // NULL se vazia e !wait
+void*      ioAllocAligned(size_t size);
+void       ioFreeAligned(void* p);
+
+// --- Pacote de assets (assets.pak mapeado uma vez; fallback para arquivos soltos) ---
+#define PACK_FILE "assets.pak"
+
+typedef struct {
+    const unsigned char* data;
+    size_t     size;
+    MappedFile map;   // só quando veio de um arquivo solto
+    unsigned char* owned;   // texto montado (shaders pré-processados)
+} AssetView;
+
+int  openAssetPack(const char* path);
+int  openAsset(const char* name, AssetView* out);
+void closeAsset(AssetView* a);
+int  buildAssetPack(const char* outPath);
+int  packAssets(void);
+int  loadShaderSource(const char* filePath, const char* defines, AssetView* out);   // #include + #define
+int  assetContentHash(const char* name, uint64_t* out);   // só do pacote (de graça); 0 para arquivo solto
+
+// --- Texturas (handle + estado do streaming) ---
+typedef enum { TEX_IDLE, TEX_DECODING, TEX_STREAMING, TEX_RESIDENT, TEX_FAILED } TextureState;
+
+#define TEXTURE_MAX_LEVELS 16
+
+typedef struct Texture {
+    GLuint id;                    // objeto amostrado pelos shaders
+    GLuint streamId;              // objeto recebendo os níveis (!= id durante uma recarga)
+    char   path[256];
+    TextureState state;
+    const unsigned char* cache;   // container TexCacheHeader + mips (enquanto há o que enviar)
+    MappedFile     map;           // cache mapeado (execuções seguintes)
+    unsigned char* owned;         // cache montado nesta execução
+    int   levelCount;
+    int   width;                  // largura do nível 0
+    size_t levelBytes[TEXTURE_MAX_LEVELS];   // VRAM estimada de cada nível
+    size_t retiredBytes;          // VRAM do objeto antigo numa recarga (até ser apagado na troca)
+    int   residentBase;           // nível mais fino já completo no GL
+    int   desiredBase;            // nível mais fino que o tamanho na tela justifica
+    int   uploadRow;              // linhas (ou linhas de blocos) já enviadas do nível seguinte
+    float minLod;                 // nível mais fino visível; desce aos poucos até residentBase
+    float priority;               // cobertura de tela (px²) somada no quadro atual
+    float coverage;               // cobertura no último quadro em que apareceu
+    unsigned lastVisibleFrame;    // último quadro em que foi desenhada
+    size_t decodePeakBytes;       // pico da arena do stb_image (0 = veio do cache)
+    int    thumbnailSaved;        // miniatura já registrada nesta sessão
+    int    refCount;              // loadTexture2D que devolveram esta textura
+    uint64_t contentKey;          // hash do arquivo-fonte (0 = desconhecido)
+    int    released;              // liberada durante a decodificação: destruir ao voltar
+    struct ProceduralParams* procedural;   // não NULL: gerada em vez de decodificada
+    struct Texture* next;         // fila de decodificações prontas
+} Texture;
+
+#define STREAM_BUDGET_DEFAULT (2u * 1024u * 1024u)
+static size_t streamBudgetBytes = STREAM_BUDGET_DEFAULT;   // bytes enviados por quadro
+
+#define TEXTURE_BUDGET_DEFAULT (256u * 1024u * 1024u)
+static size_t textureBudgetBytes = TEXTURE_BUDGET_DEFAULT; // teto de VRAM para texturas
+
+Texture* loadTexture2D(const char* path);   // compartilhada por caminho ou conteúdo iguais
+void     releaseTexture(Texture* tex);
+int      reloadTexture2D(Texture* tex, const char* path);
+void     textureUsed(Texture* tex, float coveragePx);
+int      streamTextures(void);
+size_t   textureMemoryUsed(void);
+void     fitTextureDims(int* w, int* h);   // tamanho após o limite do preset de qualidade
+void     saveTextureThumbnails(void);   // grava as miniaturas novas (chamar no encerramento)
+
+// Carregamento sob demanda: a imagem só é pedida quando o corpo passa no culling
+// cobrindo ao menos isso na tela (px²); até lá aparece a miniatura da sessão anterior.
+#define TEXTURE_REQUEST_MIN_PX 64.0f
+
+// Texturas procedurais: mapas equirretangulares gerados a partir de poucos
+// parâmetros (fBm de Perlin 3D sobre a esfera, sem costura) em vez de lidos de
+// um JPEG. Passam pelo mesmo cache, miniaturas e streaming das outras.
+typedef enum { PROC_GAS_GIANT, PROC_STAR } ProceduralKind;
+
+typedef struct ProceduralParams {
+    uint32_t kind;           // ProceduralKind
+    uint32_t seed;
+    uint32_t width;          // altura = width / 2
+    float    bands;          // faixas de latitude (gigante gasoso)
+    float    turbulence;     // quanto o ruído entorta as faixas / contraste da granulação
+    float    colors[3][3];   // paleta escuro -> médio -> claro (sRGB, 0..1)
+} ProceduralParams;
+
+static const ProceduralParams procSun     = {PROC_STAR,      1, 2048,  0.0f, 1.0f, {{0.78f, 0.22f, 0.02f}, {1.00f, 0.60f, 0.10f}, {1.00f, 0.95f, 0.72f}}};
+static const ProceduralParams procJupiter = {PROC_GAS_GIANT, 2, 2048, 14.0f, 0.9f, {{0.55f, 0.38f, 0.25f}, {0.85f, 0.72f, 0.55f}, {0.96f, 0.93f, 0.86f}}};
+static const ProceduralParams procSaturn  = {PROC_GAS_GIANT, 3, 2048, 18.0f, 0.5f, {{0.72f, 0.62f, 0.42f}, {0.86f, 0.78f, 0.58f}, {0.95f, 0.90f, 0.74f}}};
+static const ProceduralParams procUranus  = {PROC_GAS_GIANT, 4, 1024,  6.0f, 0.2f, {{0.55f, 0.78f, 0.82f}, {0.65f, 0.86f, 0.89f}, {0.75f, 0.92f, 0.94f}}};
+static const ProceduralParams procNeptune = {PROC_GAS_GIANT, 5, 1024,  8.0f, 0.6f, {{0.12f, 0.22f, 0.60f}, {0.25f, 0.40f, 0.82f}, {0.60f, 0.72f, 0.95f}}};
+
+Texture*       loadProceduralTexture(const ProceduralParams* params);   // compartilhada como loadTexture2D
+unsigned char* generateProceduralTexture(const ProceduralParams* params, int* w, int* h);   // RGB, malloc
+
+// Céu: cubemap gerado (e guardado em cache) a partir de um mapa equirretangular
+typedef struct {
+    GLuint id;                    // 0 até as faces chegarem ao GL
+    char   path[256];
+    const unsigned char* cache;   // SkyCacheHeader + 6 faces
+    MappedFile     map;
+    unsigned char* owned;
+    Mutex  lock;
+    int    done;                  // worker terminou (com ou sem sucesso)
+    int    failed;
+} Skybox;
+
+Skybox* loadSkybox(const char* equirectPath);
+int     skyboxReady(Skybox* sky);
+
+// Volume de ruído 3D que ladrilha (fBm periódico, R8): granulação animada do Sol
+// com duas leituras por pixel, sem avaliar Perlin no shader.
+#define NOISE_VOLUME_SIZE 64
+
+typedef struct {
+    GLuint id;                    // GL_TEXTURE_3D; 0 até o volume chegar ao GL
+    int    size;
+    const unsigned char* cache;   // NoiseCacheHeader + size³ bytes
+    MappedFile     map;
+    unsigned char* owned;
+    Mutex  lock;
+    int    done;
+    int    failed;
+} NoiseVolume;
+
+NoiseVolume* loadNoiseVolume(int size);
+int          noiseVolumeReady(NoiseVolume* vol);
+
+// Texturas virtuais: mapas maiores que a VRAM, em tiles sob demanda (feedback da GPU)
+typedef struct VirtualTexture VirtualTexture;
+
+// --- Malhas com cadeia de LODs ---
+#define MESH_MAX_LODS      6
+#define MESH_LOD_MIN_TRIS  300     // LOD mais grosso fica abaixo disso (objetos distantes)
+#define LOD_ERROR_PX       0.75f   // erro geométrico máximo aceito na tela (pixels)
+
+typedef struct {
+    GLsizei indexCount;
+    size_t  indexOffset;   // em bytes, dentro do EBO compartilhado
+    float   error;         // erro geométrico (espaço do objeto) em relação ao LOD 0
+} MeshLOD;
+
+typedef struct {
+    GLuint  vao, vbo, ebo;
+    MeshLOD lods[MESH_MAX_LODS];
+    int     lodCount;
+    int     refCount;     // só malhas vindas de acquire*Mesh
+    uint64_t contentKey;  // hash de vértices + índices + buildLods
+} Mesh;
+
+void createMesh(Mesh* mesh, const float* vertices, unsigned int vertexCount,
+                const unsigned int* indices, unsigned int indexCount, int buildLods);
+// Malhas compartilhadas: geometria idêntica (ou os mesmos parâmetros do gerador)
+// devolve o mesmo VAO. Cada acquire pede um releaseMesh.
+Mesh* acquireMesh(const float* vertices, unsigned int vertexCount,
+                  const unsigned int* indices, unsigned int indexCount, int buildLods);
+Mesh* acquireSphereMesh(float radius, int sectorCount, int stackCount, int buildLods);
+Mesh* acquireRingMesh(float innerR, float outerR, int segments, int buildLods);
+void  releaseMesh(Mesh* mesh);
+static int selectMeshLOD(const Mesh* mesh, float worldScale, float distance);
+static float screenRadiusPx(float worldRadius, float distance);
+static int sphereVisible(mat4 projection, mat4 view, vec3 center, float radius);
+
+VirtualTexture* loadVirtualTexture(const char* path);
+void   updateVirtualTextures(void);
+GLuint virtualTextureProgram(void);
+void   bindVirtualTexture(VirtualTexture* vt, GLuint shader, mat4 model, const Mesh* mesh, int lod);
+void   renderVirtualTextureFeedback(mat4 projection, mat4 view);
+void   shutdownVirtualTexturing(void);
+
+// --- Presets de qualidade (--quality=low|medium|high) ---
+// Um só conjunto de assets: no preset baixo as imagens são reduzidas no
+// carregamento (mesmo filtro dos mips), os níveis mais finos não vão para a GPU,
+// as malhas aceitam LODs mais grossos e os passes caros ficam desligados.
+typedef struct {
+    const char* name;
+    int    maxTextureSize;    // maior lado depois do carregamento (0 = original)
+    int    skipMips;          // níveis mais finos que nunca são enviados
+    float  lodErrorPx;        // erro geométrico aceito na tela (pixels)
+    size_t textureBudget;     // teto de VRAM para texturas (--tex-budget tem prioridade)
+    int    virtualTextures;   // thread do VT + passe de feedback
+    int    sunAnimation;      // volume de ruído 3D no Sol
+} QualityPreset;
+
+static const QualityPreset qualityPresets[] = {
+    {"low",    1024, 1, 3.0f,         48u * 1024u * 1024u,    0, 0},
+    {"medium", 4096, 0, 1.5f,         128u * 1024u * 1024u,   1, 1},
+    {"high",      0, 0, LOD_ERROR_PX, TEXTURE_BUDGET_DEFAULT, 1, 1},
+};
+static const QualityPreset* quality = &qualityPresets[2];
+
+size_t projectedTextureBytes(void);   // VRAM das texturas carregadas, inteiras, neste preset
+
+// --- Transformações dos corpos (SoA: um laço para todas as órbitas) ---
+// Entrada em arrays por campo; saída pronta para glUniformMatrix*: model, matriz
+// normal e model-view-projection. Os shaders não invertem mais nada por vértice.
+#define TRANSFORM_GRAIN 4096   // corpos por job; abaixo disso roda na thread atual
+
+typedef struct {
+    int    count, capacity;
+    float *orbitRadius, *orbitRate, *cosIncl, *sinIncl;   // órbita (rad/s)
+    float *spinPhase, *spinRate, *scale;                  // local: tilt vira fase do spin
+    mat4  *model, *mvp;
+    mat3  *normal;
+} BodyTransforms;
+
+void initBodyTransforms(BodyTransforms* xf, int capacity);
+void freeBodyTransforms(BodyTransforms* xf);
+int  addBody(BodyTransforms* xf, float orbitRadius, float orbitSpeedDeg, float orbitInclDeg,
+             float axialTiltDeg, float spinDeg, float scale);   // índice, -1 se cheio
+void updateBodyTransforms(BodyTransforms* xf, float t, mat4 viewProj);
+void setTransformUniforms(GLuint shader, mat4 model, mat4 viewProj);   // fora do lote
+int  benchTransforms(void);
 
 // --- Estrutura para planetas ---
 typedef struct {
@@ -53,67 +504,102 @@ typedef struct {
     float axialTiltDeg;    // inclinação do eixo (0 = desligado)
     float spinDeg;         // rotação diária (graus/s; use negativo p/ sentido oposto)
     float scale;           // tamanho relativo
-    GLuint texture;        // textura
+    Texture* texture;      // textura
     float orbitInclDeg;    // inclinação do plano orbital (opcional)
+    VirtualTexture* vt;    // se definido, substitui 'texture' (mapas gigantes)
+    int body;              // índice em BodyTransforms
 } Planet;
 
-// Desenha um planeta; retorna 'model' em outModel (para anexos como anéis).
+// Desenha um planeta com as matrizes já calculadas por updateBodyTransforms.
 static void draw_planet(
     const Planet* p,
-    mat4 parentModel,          // sem 'const' por causa do glm_mul
+    const BodyTransforms* xf,
     GLuint shader,
-    GLuint vao,
-    GLsizei indexCount,
-    float t,
+    const Mesh* mesh,
     mat4 projection,
     mat4 view,
     vec3 lightPos,
-    vec3 cameraPos,
-    mat4 outModel              // pode ser NULL
+    vec3 cameraPos
 ) {
-    glUseProgram(shader);
+    if (p->vt) shader = virtualTextureProgram();
+    if (!shaderProgramReady(shader)) return;   // ainda compilando: o planeta aparece no próximo quadro
 
-    glUniformMatrix4fv(glGetUniformLocation(shader, "projection"), 1, GL_FALSE, (float*)projection);
-    glUniformMatrix4fv(glGetUniformLocation(shader, "view"), 1, GL_FALSE, (float*)view);
+    // LOD e prioridade de streaming pelo tamanho na tela (raio = escala do corpo no lote)
+    float* center = xf->model[p->body][3];
+    float worldScale = xf->scale[p->body];
+    float distance = glm_vec3_distance(cameraPos, center);
+    if (!sphereVisible(projection, view, center, worldScale)) return;   // fora da tela: textura nem é pedida
+
+    glUseProgram(shader);
     glUniform3fv(glGetUniformLocation(shader, "lightPos"), 1, (float*)lightPos);
     glUniform3fv(glGetUniformLocation(shader, "viewPos"), 1, (float*)cameraPos);
+    glUniformMatrix4fv(glGetUniformLocation(shader, "model"), 1, GL_FALSE, (float*)xf->model[p->body]);
+    glUniformMatrix4fv(glGetUniformLocation(shader, "mvp"), 1, GL_FALSE, (float*)xf->mvp[p->body]);
+    glUniformMatrix3fv(glGetUniformLocation(shader, "normalMatrix"), 1, GL_FALSE, (float*)xf->normal[p->body]);
 
-    // ----- ORBITA -----
-    mat4 orbit; glm_mat4_identity(orbit);
-    if (p->orbitInclDeg != 0.0f)
-        glm_rotate(orbit, glm_rad(p->orbitInclDeg), (vec3){1.0f, 0.0f, 0.0f});
-    float ang = t * glm_rad(p->orbitSpeedDeg);
-    vec3 pos = { cosf(ang) * p->orbitRadius, 0.0f, sinf(ang) * p->orbitRadius };
-    glm_translate(orbit, pos);
-
-    // ----- LOCAL (lift, tilt, spin, escala) -----
-    mat4 local; glm_mat4_identity(local);
-    glm_rotate(local, glm_rad(+90.0f), (vec3){1.0f, 0.0f, 0.0f});            // lift
-    if (p->axialTiltDeg != 0.0f)
-        glm_rotate(local, glm_rad(p->axialTiltDeg), (vec3){0.0f, 0.0f, 1.0f}); // tilt opcional
-    float spin = t * glm_rad(p->spinDeg);
-    glm_rotate(local, spin, (vec3){0.0f, 0.0f, 1.0f});                      // spin em Z
-    glm_scale(local, (vec3){p->scale, p->scale, p->scale});
-
-    // ----- model = parent * orbit * local -----
-    mat4 model, tmp;
-    glm_mul(parentModel, orbit, tmp);
-    glm_mul(tmp, local, model);
-
-    if (outModel) glm_mat4_copy(model, outModel);
-
-    glUniformMatrix4fv(glGetUniformLocation(shader, "model"), 1, GL_FALSE, (float*)model);
-
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, p->texture);
-    glUniform1i(glGetUniformLocation(shader, "ourTexture"), 0);
+    int lod = selectMeshLOD(mesh, worldScale, distance);
+    if (p->vt){
+        bindVirtualTexture(p->vt, shader, xf->model[p->body], mesh, lod);
+    } else {
+        float radiusPx = screenRadiusPx(worldScale, distance);
+        textureUsed(p->texture, GLM_PIf * radiusPx * radiusPx);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, p->texture->id);
+        glUniform1i(glGetUniformLocation(shader, "ourTexture"), 0);
+    }
 
-    glBindVertexArray(vao);
-    glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
+    glBindVertexArray(mesh->vao);
+    glDrawElements(GL_TRIANGLES, mesh->lods[lod].indexCount, GL_UNSIGNED_INT, (void*)mesh->lods[lod].indexOffset);
 }
 
-int main(void)
+int main(int argc, char** argv)
 {
+    // --- Linha de comando (modos --bench-* e --pack rodam sem janela) ---
+    int (*toolMode)(void) = NULL;
+    const char* earthVirtualTexture = NULL;
+    int proceduralBodies = 0;   // --procedural: Sol e gigantes gasosos gerados por ruído
+    int shaderHotReload = 0;    // --hot-reload: recompila shaders editados (desenvolvimento)
+    size_t textureBudgetArg = 0;
+    for (int i = 1; i < argc; ++i){
+        if (strcmp(argv[i], "--bench-bc") == 0)   toolMode = benchBlockCompression;
+        if (strcmp(argv[i], "--bench-mips") == 0) toolMode = benchMipmaps;
+        if (strcmp(argv[i], "--pack") == 0)       toolMode = packAssets;     // gera assets.pak a partir de assets/
+        if (strncmp(argv[i], "--bench-io", 10) == 0){   // --bench-io[=arquivo], padrão assets.pak
+            toolMode = benchAsyncIO;
+            if (argv[i][10] == '=') benchIoPath = argv[i] + 11;
+        }
+        if (strcmp(argv[i], "--bench-decode") == 0) toolMode = benchDecoders;
+        if (strcmp(argv[i], "--bench-noise") == 0)  toolMode = benchNoise;
+        if (strcmp(argv[i], "--bench-transforms") == 0) toolMode = benchTransforms;
+        if (strcmp(argv[i], "--procedural") == 0)   proceduralBodies = 1;
+        if (strcmp(argv[i], "--hot-reload") == 0)   shaderHotReload = 1;
+        if (strncmp(argv[i], "--decoder=", 10) == 0)     // stb | stb-rstn | libjpeg | libpng
+            selectImageDecoder(argv[i] + 10);
+        if (strncmp(argv[i], "--bench-jpeg", 12) == 0){   // --bench-jpeg[=arquivo]
+            toolMode = benchJpegDecode;
+            if (argv[i][12] == '=') benchJpegPath = argv[i] + 13;
+        }
+        if (strncmp(argv[i], "--stream-budget=", 16) == 0){  // KB enviados por quadro (mínimo 1)
+            unsigned long kb = strtoul(argv[i] + 16, NULL, 10);
+            streamBudgetBytes = (size_t)(kb > 0 ? kb : 1) * 1024u;   // 0 nunca enviaria nada
+        }
+        if (strncmp(argv[i], "--tex-budget=", 13) == 0)      // MB de VRAM para texturas
+            textureBudgetArg = (size_t)strtoul(argv[i] + 13, NULL, 10) * 1024u * 1024u;
+        if (strncmp(argv[i], "--quality=", 10) == 0){        // low | medium | high
+            for (int q = 0; q < 3; ++q)
+                if (strcmp(argv[i] + 10, qualityPresets[q].name) == 0) quality = &qualityPresets[q];
+        }
+        if (strncmp(argv[i], "--vt-terra=", 11) == 0)        // mapa gigante da Terra (textura virtual)
+            earthVirtualTexture = argv[i] + 11;
+        if (strncmp(argv[i], "--mip-filter=", 13) == 0){     // box | kaiser | lanczos
+            for (int f = 0; f < 3; ++f)
+                if (strcmp(argv[i] + 13, mipFilterNames[f]) == 0) mipFilter = (MipFilter)f;
+        }
+    }
+    textureBudgetBytes = textureBudgetArg ? textureBudgetArg : quality->textureBudget;
+    if (toolMode) return toolMode();
+    openAssetPack(PACK_FILE);   // opcional: sem ele, tudo sai dos arquivos soltos
+
     // --- Inicialização ---
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
@@ -135,82 +621,68 @@ int main(void)
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-    // --- Shaders ---
-    unsigned int objectShaderProgram = createShaderProgram("assets/shaders/object_vertex.glsl", "assets/shaders/object_fragment.glsl");
-    unsigned int lightShaderProgram  = createShaderProgram("assets/shaders/light_vertex.glsl",  "assets/shaders/light_fragment.glsl");
-    unsigned int skyShaderProgram    = createShaderProgram("assets/shaders/sky_vertex.glsl",    "assets/shaders/sky_fragment.glsl");
-
-    // --- Geometria (Esfera) ---
-    float* sphereVerts; unsigned int sphereVCount;
-    unsigned int* sphereIdx; unsigned int sphereICount;
-    generateSphere(1.0f, 48, 24, &sphereVerts, &sphereVCount, &sphereIdx, &sphereICount);
-
-    unsigned int sphereVBO, sphereEBO, sphereVAO;
-    glGenVertexArrays(1, &sphereVAO);
-    glGenBuffers(1, &sphereVBO);
-    glGenBuffers(1, &sphereEBO);
-
-    glBindVertexArray(sphereVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, sphereVBO);
-    glBufferData(GL_ARRAY_BUFFER, sphereVCount * 8 * sizeof(float), sphereVerts, GL_STATIC_DRAW);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sphereEBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sphereICount * sizeof(unsigned int), sphereIdx, GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-    free(sphereVerts);
-    free(sphereIdx);
-
-    // --- Anel (para Saturno) ---
-    float* ringVerts; unsigned int ringVCount;
-    unsigned int* ringIdx; unsigned int ringICount;
-    generateRing(1.0f, 2.0f, 128, &ringVerts, &ringVCount, &ringIdx, &ringICount);
-
-    unsigned int ringVBO, ringEBO, ringVAO;
-    glGenVertexArrays(1, &ringVAO);
-    glGenBuffers(1, &ringVBO);
-    glGenBuffers(1, &ringEBO);
-
-    glBindVertexArray(ringVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, ringVBO);
-    glBufferData(GL_ARRAY_BUFFER, ringVCount * 8 * sizeof(float), ringVerts, GL_STATIC_DRAW);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ringEBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, ringICount * sizeof(unsigned int), ringIdx, GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-    free(ringVerts);
-    free(ringIdx);
-
-    // --- Texturas ---
+    // --- Texturas (decodificadas em paralelo; placeholder até o upload) ---
+    texCompression = glfwExtensionSupported("GL_EXT_texture_compression_s3tc");
+    if (!initProgramCache()) printf("Cache de programas indisponivel (sem GL_ARB_get_program_binary)\n");
+    printf("Compilacao de shaders: %s\n", initParallelShaderCompile() ? "paralela no driver" : "assincrona simples");
+    jobPoolStart(&workers, cpuCount() > 1 ? cpuCount() - 1 : 1);
+    printf("E/S assincrona: %s\n", ioBackendNames[ioStart(1)]);
+    initColorLUTs();
     stbi_set_flip_vertically_on_load(1);
-    GLuint texSun      = loadTexture2D("assets/textures/sol.jpg");
-    GLuint texMerc     = loadTexture2D("assets/textures/mercurio.jpg");
-    GLuint texVenus    = loadTexture2D("assets/textures/venus.jpg");
-    GLuint texEarth    = loadTexture2D("assets/textures/terra.jpg");
-    GLuint texMars     = loadTexture2D("assets/textures/marte.jpg");
-    GLuint texJup      = loadTexture2D("assets/textures/jupiter.jpg");
-    GLuint texSat      = loadTexture2D("assets/textures/saturno.jpg");
-    GLuint texUra      = loadTexture2D("assets/textures/urano.jpg");
-    GLuint texNep      = loadTexture2D("assets/textures/netuno.jpg");
-    GLuint texSatRings = loadTexture2D("assets/textures/saturno_aneis.png");
-    GLuint texStars    = loadTexture2D("assets/textures/estrelas.jpg");
-
-    // --- Planetas (valores “de jogo”) ---
-    Planet mercurio = {"Mercurio",  1.10f,  55.0f,  0.0f, 140.0f, 0.10f, texMerc,  7.0f};
-    Planet venus    = {"Venus",     1.70f,  43.0f,  0.0f, -30.0f, 0.13f, texVenus, 3.4f};
-    Planet terra    = {"Terra",     2.50f,  20.0f,  0.0f, -80.0f, 0.25f, texEarth, 0.0f};
-    Planet marte    = {"Marte",     3.40f,  16.0f,  0.0f,  80.0f, 0.18f, texMars,  1.9f};
-    Planet jupiter  = {"Jupiter",   4.90f,  10.0f,  0.0f, 250.0f, 0.60f, texJup,   1.3f};
-    Planet saturno  = {"Saturno",   6.20f,   8.0f,  0.0f, 220.0f, 0.55f, texSat,   2.5f};
-    Planet urano    = {"Urano",     7.40f,   6.0f,  0.0f,-150.0f, 0.45f, texUra,   0.8f};
-    Planet netuno   = {"Netuno",    8.40f,   5.0f,  0.0f, 180.0f, 0.42f, texNep,   1.8f};
+    Texture* texSun      = proceduralBodies ? loadProceduralTexture(&procSun) : loadTexture2D("assets/textures/sol.jpg");
+    Texture* texMerc     = loadTexture2D("assets/textures/mercurio.jpg");
+    Texture* texVenus    = loadTexture2D("assets/textures/venus.jpg");
+    Texture* texEarth    = loadTexture2D("assets/textures/terra.jpg");
+    Texture* texMars     = loadTexture2D("assets/textures/marte.jpg");
+    Texture* texJup      = proceduralBodies ? loadProceduralTexture(&procJupiter) : loadTexture2D("assets/textures/jupiter.jpg");
+    Texture* texSat      = proceduralBodies ? loadProceduralTexture(&procSaturn)  : loadTexture2D("assets/textures/saturno.jpg");
+    Texture* texUra      = proceduralBodies ? loadProceduralTexture(&procUranus)  : loadTexture2D("assets/textures/urano.jpg");
+    Texture* texNep      = proceduralBodies ? loadProceduralTexture(&procNeptune) : loadTexture2D("assets/textures/netuno.jpg");
+    Texture* texSatRings = loadTexture2D("assets/textures/saturno_aneis.png");
+    Skybox*  sky         = loadSkybox("assets/textures/estrelas.jpg");
+    NoiseVolume* sunNoise = quality->sunAnimation ? loadNoiseVolume(NOISE_VOLUME_SIZE) : NULL;
+    glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+
+    // --- Shaders (só disparados aqui; o status é lido no primeiro uso) ---
+    ShaderProgram* objectShader = acquireShaderProgram("assets/shaders/object_vertex.glsl", "assets/shaders/object_fragment.glsl", NULL);
+    ShaderProgram* ringShader   = acquireShaderProgram("assets/shaders/object_vertex.glsl", "assets/shaders/object_fragment.glsl", "ALPHA_BLEND");
+    ShaderProgram* lightShader  = acquireShaderProgram("assets/shaders/light_vertex.glsl",  "assets/shaders/light_fragment.glsl", NULL);
+    ShaderProgram* skyShader    = acquireShaderProgram("assets/shaders/sky_vertex.glsl",    "assets/shaders/sky_fragment.glsl", NULL);
+    if (!objectShader || !ringShader || !lightShader || !skyShader) { glfwTerminate(); return -1; }
+    if (shaderHotReload)
+        printf("Hot reload de shaders: %s\n", startShaderHotReload("assets/shaders") ? "inotify" : "varredura periodica");
+
+    // --- Geometria (esfera com LODs e anel de Saturno) ---
+    Mesh* sphere = acquireSphereMesh(1.0f, 48, 24, 1);
+    Mesh* ring   = acquireRingMesh(1.0f, 2.0f, 128, 0);
+
+    // --- Céu (triângulo de tela cheia; vértices gerados no shader) ---
+    GLuint skyVAO;
+    glGenVertexArrays(1, &skyVAO);
+
+    // --- Planetas (valores “de jogo”; vt e body são preenchidos logo abaixo) ---
+    Planet mercurio = {"Mercurio",  1.10f,  55.0f,  0.0f, 140.0f, 0.10f, texMerc,  7.0f, NULL, -1};
+    Planet venus    = {"Venus",     1.70f,  43.0f,  0.0f, -30.0f, 0.13f, texVenus, 3.4f, NULL, -1};
+    Planet terra    = {"Terra",     2.50f,  20.0f,  0.0f, -80.0f, 0.25f, texEarth, 0.0f, NULL, -1};
+    Planet marte    = {"Marte",     3.40f,  16.0f,  0.0f,  80.0f, 0.18f, texMars,  1.9f, NULL, -1};
+    Planet jupiter  = {"Jupiter",   4.90f,  10.0f,  0.0f, 250.0f, 0.60f, texJup,   1.3f, NULL, -1};
+    Planet saturno  = {"Saturno",   6.20f,   8.0f,  0.0f, 220.0f, 0.55f, texSat,   2.5f, NULL, -1};
+    Planet urano    = {"Urano",     7.40f,   6.0f,  0.0f,-150.0f, 0.45f, texUra,   0.8f, NULL, -1};
+    Planet netuno   = {"Netuno",    8.40f,   5.0f,  0.0f, 180.0f, 0.42f, texNep,   1.8f, NULL, -1};
+    if (earthVirtualTexture && !quality->virtualTextures)
+        printf("Aviso: texturas virtuais desligadas no preset %s\n", quality->name);
+    else if (earthVirtualTexture) terra.vt = loadVirtualTexture(earthVirtualTexture);
+    Planet* planets[] = {&mercurio, &venus, &terra, &marte, &jupiter, &saturno, &urano, &netuno};
+    const int planetCount = (int)(sizeof(planets) / sizeof(planets[0]));
+    BodyTransforms bodies;
+    initBodyTransforms(&bodies, planetCount);
+    for (int i = 0; i < planetCount; ++i){
+        Planet* p = planets[i];
+        p->body = addBody(&bodies, p->orbitRadius, p->orbitSpeedDeg, p->orbitInclDeg, p->axialTiltDeg, p->spinDeg, p->scale);
+    }
+    printf("Qualidade %s: texturas inteiras ocupariam %.1f MB de VRAM (teto %.0f MB)\n", quality->name,
+           projectedTextureBytes() / (1024.0 * 1024.0), textureBudgetBytes / (1024.0 * 1024.0));
+    int residentReported = 0;
 
     // --- LOOP ---
     while (!glfwWindowShouldClose(window))
@@ -220,6 +692,18 @@ int main(void)
         lastFrame = currentFrame;
 
         processInput(window);
+        int pendingTextures = streamTextures();   // envia mips das imagens que os workers já terminaram
+        if (!pendingTextures && !residentReported && textureMemoryUsed() > 0){
+            printf("Qualidade %s: %.1f MB de texturas residentes\n", quality->name,
+                   textureMemoryUsed() / (1024.0 * 1024.0));
+            residentReported = 1;
+        }
+        updateVirtualTextures();
+        updateShaderHotReload();   // pode trocar os ids abaixo
+        unsigned int objectShaderProgram = objectShader->id;
+        unsigned int ringShaderProgram   = ringShader->id;
+        unsigned int lightShaderProgram  = lightShader->id;
+        unsigned int skyShaderProgram    = skyShader->id;
 
         glClearColor(0.0f, 0.0f, 0.05f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -228,101 +712,113 @@ int main(void)
         glm_perspective(glm_rad(fovDeg), (float)winW / (float)winH, 0.1f, 200.0f, projection);
         vec3 center; glm_vec3_add(cameraPos, cameraFront, center);
         glm_lookat(cameraPos, center, cameraUp, view);
+        mat4 viewProj;
+        glm_mat4_mul(projection, view, viewProj);
 
-        // --- CÉU ESTRELADO (desenha primeiro) ---
-        glDepthMask(GL_FALSE);                       // não escrever no depth
-        glUseProgram(skyShaderProgram);
-        glUniformMatrix4fv(glGetUniformLocation(skyShaderProgram, "projection"), 1, GL_FALSE, (float*)projection);
+        vec3 lightPos = {0.0f, 0.0f, 0.0f};
 
-        // Remover a translação da view para o sky ficar "colado" na câmera
-        mat4 viewNoTrans; 
-        glm_mat4_copy(view, viewNoTrans);
-        viewNoTrans[3][0] = 0.0f; viewNoTrans[3][1] = 0.0f; viewNoTrans[3][2] = 0.0f;
-        glUniformMatrix4fv(glGetUniformLocation(skyShaderProgram, "view"), 1, GL_FALSE, (float*)viewNoTrans);
+        glDisable(GL_BLEND);   // variantes opacas até os anéis
 
-        mat4 skyModel; 
-        glm_mat4_identity(skyModel);
-        glm_rotate(skyModel, glm_rad(-90.0f), (vec3){1.0f, 0.0f, 0.0f}); // se seu atlas pedir
-        glm_scale(skyModel, (vec3){100.0f, 100.0f, 100.0f});             // esfera gigante
-        glUniformMatrix4fv(glGetUniformLocation(skyShaderProgram, "model"), 1, GL_FALSE, (float*)skyModel);
+        // --- SOL ---
+        if (shaderProgramReady(lightShaderProgram)){   // usar antes do link terminar travaria o quadro
+            glUseProgram(lightShaderProgram);
 
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, texStars);
-        glUniform1i(glGetUniformLocation(skyShaderProgram, "skyTex"), 0);
+            mat4 sunModel;
+            glm_mat4_identity(sunModel);
+            glm_translate(sunModel, lightPos);
+            glm_rotate(sunModel, glm_rad(-90.0f), (vec3){1.0f, 0.0f, 0.0f}); // ajuste de textura se necessário
+            glm_scale(sunModel, (vec3){0.7f, 0.7f, 0.7f});
+            setTransformUniforms(lightShaderProgram, sunModel, viewProj);
 
-        glEnable(GL_CULL_FACE);
-        glCullFace(GL_FRONT); // desenha faces internas
-        glBindVertexArray(sphereVAO);
-        glDrawElements(GL_TRIANGLES, sphereICount, GL_UNSIGNED_INT, 0);
-        glCullFace(GL_BACK);
-        glDisable(GL_CULL_FACE);
-        glDepthMask(GL_TRUE);                        // volta a escrever no depth
+            if (sphereVisible(projection, view, lightPos, 0.7f)){
+                int animated = sunNoise && noiseVolumeReady(sunNoise);   // até lá, só a textura
+                glActiveTexture(GL_TEXTURE1);
+                glBindTexture(GL_TEXTURE_3D, animated ? sunNoise->id : 0);
+                glUniform1i(glGetUniformLocation(lightShaderProgram, "noiseVolume"), 1);
+                glUniform1f(glGetUniformLocation(lightShaderProgram, "noiseStrength"), animated ? 1.0f : 0.0f);
+                glUniform1f(glGetUniformLocation(lightShaderProgram, "time"), currentFrame);
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D, texSun->id);
+                glUniform1i(glGetUniformLocation(lightShaderProgram, "ourTexture"), 0);
+                float sunDist = glm_vec3_distance(cameraPos, lightPos);
+                float sunPx = screenRadiusPx(0.7f, sunDist);
+                textureUsed(texSun, GLM_PIf * sunPx * sunPx);
+                int sunLod = selectMeshLOD(sphere, 0.7f, sunDist);
+                glBindVertexArray(sphere->vao);
+                glDrawElements(GL_TRIANGLES, sphere->lods[sunLod].indexCount, GL_UNSIGNED_INT, (void*)sphere->lods[sunLod].indexOffset);
+            }
+        }
 
-        vec3 lightPos = {0.0f, 0.0f, 0.0f};
+        // --- PLANETAS ---
+        float t = (float)glfwGetTime();
+        updateBodyTransforms(&bodies, t, viewProj);   // todas as órbitas de uma vez
+        int planetsReady = shaderProgramReady(objectShaderProgram);   // uma vez por quadro (os anéis dependem dele)
+        for (int i = 0; i < planetCount; ++i)
+            draw_planet(planets[i], &bodies, objectShaderProgram, sphere, projection, view, lightPos, cameraPos);
 
-        // --- SOL ---
-        glUseProgram(lightShaderProgram);
-        glUniformMatrix4fv(glGetUniformLocation(lightShaderProgram, "projection"), 1, GL_FALSE, (float*)projection);
-        glUniformMatrix4fv(glGetUniformLocation(lightShaderProgram, "view"), 1, GL_FALSE, (float*)view);
+        // --- CÉU ESTRELADO (depois dos opacos: só cobre os pixels que ficaram no fundo) ---
+        if (skyboxReady(sky) && shaderProgramReady(skyShaderProgram)){
+            // Sem a translação da view o céu fica "colado" na câmera
+            mat4 viewNoTrans, skyViewProj, invSkyViewProj;
+            glm_mat4_copy(view, viewNoTrans);
+            viewNoTrans[3][0] = 0.0f; viewNoTrans[3][1] = 0.0f; viewNoTrans[3][2] = 0.0f;
+            glm_mat4_mul(projection, viewNoTrans, skyViewProj);
+            glm_mat4_inv(skyViewProj, invSkyViewProj);
 
-        mat4 sunModel;
-        glm_mat4_identity(sunModel);
-        glm_translate(sunModel, lightPos);
-        glm_rotate(sunModel, glm_rad(-90.0f), (vec3){1.0f, 0.0f, 0.0f}); // ajuste de textura se necessário
-        glm_scale(sunModel, (vec3){0.7f, 0.7f, 0.7f});
-        glUniformMatrix4fv(glGetUniformLocation(lightShaderProgram, "model"), 1, GL_FALSE, (float*)sunModel);
+            glUseProgram(skyShaderProgram);
+            glUniformMatrix4fv(glGetUniformLocation(skyShaderProgram, "invViewProj"), 1, GL_FALSE, (float*)invSkyViewProj);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_CUBE_MAP, sky->id);
+            glUniform1i(glGetUniformLocation(skyShaderProgram, "skyTex"), 0);
 
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, texSun);
-        glUniform1i(glGetUniformLocation(lightShaderProgram, "ourTexture"), 0);
-        glBindVertexArray(sphereVAO);
-        glDrawElements(GL_TRIANGLES, sphereICount, GL_UNSIGNED_INT, 0);
+            glDepthFunc(GL_LEQUAL);                  // o triângulo fica em profundidade 1.0
+            glDepthMask(GL_FALSE);
+            glBindVertexArray(skyVAO);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+            glDepthMask(GL_TRUE);
+            glDepthFunc(GL_LESS);
+        }
 
-        // --- PLANETAS ---
-        float t = (float)glfwGetTime();
-        mat4 I; glm_mat4_identity(I);
-
-        draw_planet(&mercurio, I, objectShaderProgram, sphereVAO, sphereICount, t, projection, view, lightPos, cameraPos, NULL);
-        draw_planet(&venus,    I, objectShaderProgram, sphereVAO, sphereICount, t, projection, view, lightPos, cameraPos, NULL);
-        draw_planet(&terra,    I, objectShaderProgram, sphereVAO, sphereICount, t, projection, view, lightPos, cameraPos, NULL);
-        draw_planet(&marte,    I, objectShaderProgram, sphereVAO, sphereICount, t, projection, view, lightPos, cameraPos, NULL);
-        draw_planet(&jupiter,  I, objectShaderProgram, sphereVAO, sphereICount, t, projection, view, lightPos, cameraPos, NULL);
-
-        // Saturno (captura model para anexar anéis)
-        mat4 saturnModel;
-        draw_planet(&saturno,  I, objectShaderProgram, sphereVAO, sphereICount, t, projection, view, lightPos, cameraPos, saturnModel);
-
-        // --- ANÉIS DE SATURNO ---
-        glUseProgram(objectShaderProgram);
-        glUniformMatrix4fv(glGetUniformLocation(objectShaderProgram, "projection"), 1, GL_FALSE, (float*)projection);
-        glUniformMatrix4fv(glGetUniformLocation(objectShaderProgram, "view"), 1, GL_FALSE, (float*)view);
-        glUniform3fv(glGetUniformLocation(objectShaderProgram, "lightPos"), 1, (float*)lightPos);
-        glUniform3fv(glGetUniformLocation(objectShaderProgram, "viewPos"), 1, (float*)cameraPos);
-
-        mat4 modelRings;
-        glm_mat4_copy(saturnModel, modelRings);
-        // desfaz o lift do planeta para o anel ficar no plano XZ do mundo
-        glm_rotate(modelRings, glm_rad(-90.0f), (vec3){1.0f, 0.0f, 0.0f});
-        float ringScale = 0.55f * 2.8f; // ajuste visual
-        glm_scale(modelRings, (vec3){ringScale, ringScale, ringScale});
-        glUniformMatrix4fv(glGetUniformLocation(objectShaderProgram, "model"), 1, GL_FALSE, (float*)modelRings);
+        // --- ANÉIS DE SATURNO (translúcidos: por último, sobre o céu) ---
+        if (planetsReady && shaderProgramReady(ringShaderProgram)){   // mesmo quadro em que Saturno apareceu
+            glEnable(GL_BLEND);   // só os anéis misturam; opacos e céu vão sem blend
+            glUseProgram(ringShaderProgram);
+            glUniform3fv(glGetUniformLocation(ringShaderProgram, "lightPos"), 1, (float*)lightPos);
+            glUniform3fv(glGetUniformLocation(ringShaderProgram, "viewPos"), 1, (float*)cameraPos);
 
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, texSatRings);
-        glUniform1i(glGetUniformLocation(objectShaderProgram, "ourTexture"), 0);
-        glDisable(GL_CULL_FACE); // ver anel por cima e por baixo
-        glBindVertexArray(ringVAO);
-        glDrawElements(GL_TRIANGLES, ringICount, GL_UNSIGNED_INT, 0);
-        glEnable(GL_CULL_FACE);
+            mat4 modelRings;
+            glm_mat4_copy(bodies.model[saturno.body], modelRings);
+            // desfaz o lift do planeta para o anel ficar no plano XZ do mundo
+            glm_rotate(modelRings, glm_rad(-90.0f), (vec3){1.0f, 0.0f, 0.0f});
+            float ringScale = 0.55f * 2.8f; // ajuste visual
+            glm_scale(modelRings, (vec3){ringScale, ringScale, ringScale});
+            setTransformUniforms(ringShaderProgram, modelRings, viewProj);
+
+            if (sphereVisible(projection, view, modelRings[3], 2.0f * ringScale)){
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D, texSatRings->id);
+                float ringPx = screenRadiusPx(2.0f * ringScale, glm_vec3_distance(cameraPos, modelRings[3]));
+                textureUsed(texSatRings, GLM_PIf * ringPx * ringPx);
+                glUniform1i(glGetUniformLocation(ringShaderProgram, "ourTexture"), 0);
+                glDisable(GL_CULL_FACE); // ver anel por cima e por baixo
+                glBindVertexArray(ring->vao);
+                glDrawElements(GL_TRIANGLES, ring->lods[0].indexCount, GL_UNSIGNED_INT, 0);
+                glEnable(GL_CULL_FACE);
+            }
+        }
 
-        draw_planet(&urano,    I, objectShaderProgram, sphereVAO, sphereICount, t, projection, view, lightPos, cameraPos, NULL);
-        draw_planet(&netuno,   I, objectShaderProgram, sphereVAO, sphereICount, t, projection, view, lightPos, cameraPos, NULL);
+        renderVirtualTextureFeedback(projection, view);   // tiles pedidos neste quadro
 
         glfwSwapBuffers(window);
         glfwPollEvents();
     }
 
     // Encerramento simples (OpenGL será limpo pelo SO; adicione glDelete* se desejar)
+    freeBodyTransforms(&bodies);
+    shutdownVirtualTexturing();
+    saveTextureThumbnails();   // miniaturas para a próxima sessão
+    ioStop();
+    jobPoolStop(&workers);
     glfwTerminate();
     return 0;
 }
@@ -390,152 +886,5771 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height){
     glViewport(0, 0, width, height);
 }
 
-char* loadShaderSource(const char* filePath){
-    FILE* file = fopen(filePath, "rb");
-    if (!file){ printf("Falha ao abrir o arquivo do shader: %s\n", filePath); return NULL; }
-    fseek(file, 0, SEEK_END); long length = ftell(file); fseek(file, 0, SEEK_SET);
-    char* buffer = (char*)malloc(length + 1);
-    fread(buffer, 1, length, file); fclose(file);
-    buffer[length] = '\0'; return buffer;
-}
-
-unsigned int createShaderProgram(const char* vertexPath, const char* fragmentPath){
-    char* vertexSource = loadShaderSource(vertexPath);
-    char* fragmentSource = loadShaderSource(fragmentPath);
+// --- Pré-processador de shaders ---
+// O GLSL não tem #include: o texto é montado aqui. '#include "arquivo"' é
+// resolvido relativo ao arquivo que inclui (cada arquivo entra uma vez só) e as
+// diretivas '#line linha fonte' mantêm os logs do driver apontando para o arquivo
+// certo (fonte 0 = o shader pedido; 1, 2... = includes na ordem em que entraram).
+// Os #define da variante ("NOME" ou "NOME=valor", separados por espaço) entram
+// logo depois do #version.
+#define SHADER_MAX_FILES 16
 
-    unsigned int vs = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vs, 1, (const char * const*)&vertexSource, NULL);
-    glCompileShader(vs);
+typedef int (*AssetOpenFn)(const char* name, AssetView* out);
 
-    unsigned int fs = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fs, 1, (const char * const*)&fragmentSource, NULL);
-    glCompileShader(fs);
+typedef struct {
+    char*  data;
+    size_t size, capacity;
+    char   files[SHADER_MAX_FILES][256];
+    int    fileCount;
+    AssetOpenFn open;
+} ShaderText;
 
-    unsigned int prog = glCreateProgram();
-    glAttachShader(prog, vs); glAttachShader(prog, fs); glLinkProgram(prog);
+static void shaderAppend(ShaderText* t, const char* s, size_t n){
+    if (t->size + n + 1 > t->capacity){
+        size_t cap = t->capacity ? t->capacity : 4096;
+        while (t->size + n + 1 > cap) cap *= 2;
+        t->data = (char*)realloc(t->data, cap);
+        t->capacity = cap;
+    }
+    memcpy(t->data + t->size, s, n);
+    t->size += n;
+    t->data[t->size] = '\0';
+}
 
-    glDeleteShader(vs); glDeleteShader(fs);
-    free(vertexSource); free(fragmentSource);
-    return prog;
+static void shaderAppendf(ShaderText* t, const char* fmt, ...){
+    char buf[512];
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+    if (n > 0) shaderAppend(t, buf, (size_t)n < sizeof(buf) ? (size_t)n : sizeof(buf) - 1);
 }
 
-GLuint loadTexture2D(const char* path){
-    GLuint id; glGenTextures(1, &id);
-    glBindTexture(GL_TEXTURE_2D, id);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);	
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    int w,h,n; unsigned char *data = stbi_load(path, &w, &h, &n, 0);
-    if (data){
-        GLenum fmt = (n == 4 ? GL_RGBA : GL_RGB);
-        glTexImage2D(GL_TEXTURE_2D, 0, fmt, w, h, 0, fmt, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-    } else {
-        printf("Falha ao carregar textura: %s\n", path);
+static void shaderAppendDefines(ShaderText* t, const char* defines){
+    for (const char* p = defines; p && *p; ){
+        while (*p == ' ') p++;
+        size_t n = strcspn(p, " ");
+        if (!n) break;
+        const char* eq = memchr(p, '=', n);
+        if (eq) shaderAppendf(t, "#define %.*s %.*s\n", (int)(eq - p), p, (int)(n - (size_t)(eq - p) - 1), eq + 1);
+        else    shaderAppendf(t, "#define %.*s\n", (int)n, p);
+        p += n;
     }
-    stbi_image_free(data);
-    return id;
 }
 
-// Esfera
-void generateSphere(float radius, int sectorCount, int stackCount, 
-                    float** vertices, unsigned int* vertexCount, 
-                    unsigned int** indices, unsigned int* indexCount){
-    *vertexCount = (sectorCount + 1) * (stackCount + 1);
-    float* sphereVertices = (float*)malloc(*vertexCount * 8 * sizeof(float));
-    float lengthInv = 1.0f / radius;
-    float sectorStep = 2.0f * (float)M_PI / sectorCount;
-    float stackStep  = (float)M_PI / stackCount;
-    int vertexIndex = 0;
-    for (int i = 0; i <= stackCount; ++i) {
-        float stackAngle = (float)M_PI / 2.0f - i * stackStep; // i=0 -> polo norte
-        float xy = radius * cosf(stackAngle);
-        float z  = radius * sinf(stackAngle);
-        for (int j = 0; j <= sectorCount; ++j) {
-            float sectorAngle = j * sectorStep;
-            float x = xy * cosf(sectorAngle);
-            float y = xy * sinf(sectorAngle);
-            // pos
-            sphereVertices[vertexIndex++] = x;
-            sphereVertices[vertexIndex++] = y;
-            sphereVertices[vertexIndex++] = z;
-            // normal
-            sphereVertices[vertexIndex++] = x * lengthInv;
-            sphereVertices[vertexIndex++] = y * lengthInv;
-            sphereVertices[vertexIndex++] = z * lengthInv;
-            // uv
-            float s = (float)j / sectorCount;
-            float t = (float)i / stackCount; // i=0 (norte) -> t=0 ; STB já está flipando a imagem
-            sphereVertices[vertexIndex++] = s;
-            sphereVertices[vertexIndex++] = t;
-        }
+static int shaderIncludeFile(ShaderText* t, const char* path, const char* defines, int depth){
+    int index = t->fileCount;
+    if (index == SHADER_MAX_FILES){ printf("Includes demais no shader (%s)\n", path); return 0; }
+    snprintf(t->files[t->fileCount++], sizeof(t->files[0]), "%s", path);
+    AssetView src;
+    if (!t->open(path, &src)){
+        if (depth) printf("Falha ao abrir o include do shader: %s\n", path);   // o principal: quem chamou avisa
+        return 0;
     }
-    *vertices = sphereVertices;
+    if (depth) shaderAppendf(t, "#line 1 %d\n", index);
 
-    *indexCount = stackCount * sectorCount * 6;
-    unsigned int* sphereIndices = (unsigned int*)malloc(*indexCount * sizeof(unsigned int));
-    int index = 0;
-    for (int i = 0; i < stackCount; ++i) {
-        int k1 = i * (sectorCount + 1);
-        int k2 = k1 + sectorCount + 1;
-        for (int j = 0; j < sectorCount; ++j, ++k1, ++k2) {
-            if (i != 0) {
-                sphereIndices[index++] = k1; 
-                sphereIndices[index++] = k2; 
-                sphereIndices[index++] = k1 + 1;
-            }
-            if (i != (stackCount - 1)) {
-                sphereIndices[index++] = k1 + 1; 
-                sphereIndices[index++] = k2; 
-                sphereIndices[index++] = k2 + 1;
-            }
+    const char* text = (const char*)src.data;
+    const char* end = text + src.size;
+    int lineNo = 0, ok = 1;
+    for (const char* line = text; ok && line < end; ){
+        const char* eol = memchr(line, '\n', (size_t)(end - line));
+        const char* next = eol ? eol + 1 : end;
+        size_t len = (size_t)((eol ? eol : end) - line);
+        lineNo++;
+        const char* p = line;
+        while (p < line + len && (*p == ' ' || *p == '\t')) p++;
+        size_t rest = (size_t)(line + len - p);
+
+        if (rest >= 8 && !memcmp(p, "#include", 8)){
+            const char* q1 = memchr(p, '"', rest);
+            const char* q2 = q1 ? memchr(q1 + 1, '"', (size_t)(line + len - q1 - 1)) : NULL;
+            if (!q2){ printf("#include malformado em %s:%d\n", path, lineNo); ok = 0; break; }
+            char child[256];
+            const char* slash = strrchr(path, '/');
+            int dirLen = slash ? (int)(slash - path + 1) : 0;
+            snprintf(child, sizeof(child), "%.*s%.*s", dirLen, path, (int)(q2 - q1 - 1), q1 + 1);
+            int seen = 0;
+            for (int i = 0; i < t->fileCount; ++i) seen |= !strcmp(t->files[i], child);
+            if (!seen) ok = shaderIncludeFile(t, child, NULL, depth + 1);   // "uma vez só" também corta ciclos
+            shaderAppendf(t, "#line %d %d\n", lineNo + 1, index);
+        } else if (rest >= 8 && !memcmp(p, "#version", 8)){
+            if (!depth){
+                shaderAppend(t, line, len);
+                shaderAppend(t, "\n", 1);
+                shaderAppendDefines(t, defines);
+                shaderAppendf(t, "#line %d 0\n", lineNo + 1);
+            } else shaderAppend(t, "\n", 1);   // só o arquivo principal declara a versão
+        } else {
+            shaderAppend(t, line, len);
+            shaderAppend(t, "\n", 1);
         }
+        line = next;
     }
-    *indices = sphereIndices;
+    closeAsset(&src);
+    return ok;
 }
 
-// Anel (malha em XZ, normal em +Y)
-void generateRing(float innerR, float outerR, int segments,
-                  float** vertices, unsigned int* vertexCount,
-                  unsigned int** indices, unsigned int* indexCount){
-    if (segments < 3) segments = 3;
-    int rings = 2;
-    *vertexCount = (unsigned int)(segments * rings);
-    float* ringVerts = (float*)malloc((*vertexCount) * 8 * sizeof(float));
+static int preprocessShader(const char* path, const char* defines, AssetOpenFn open, AssetView* out){
+    ShaderText t;
+    memset(&t, 0, sizeof(t));
+    t.open = open;
+    memset(out, 0, sizeof(*out));
+    if (!shaderIncludeFile(&t, path, defines, 0)){ free(t.data); return 0; }
+    out->owned = (unsigned char*)t.data;
+    out->data = out->owned;
+    out->size = t.size;
+    return 1;
+}
 
-    int vid = 0;
-    for (int i = 0; i < segments; ++i){
-        float a = (float)i / (float)segments * 2.0f * (float)M_PI;
-        float ca = cosf(a), sa = sinf(a);
+static int openLooseAsset(const char* path, AssetView* out){
+    memset(out, 0, sizeof(*out));
+    if (!mapFile(path, &out->map)) return 0;
+    out->data = out->map.data;
+    out->size = out->map.size;
+    return 1;
+}
 
-        // outer
-        float xo = outerR * ca;
-        float zo = outerR * sa;
-        ringVerts[vid++] = xo; ringVerts[vid++] = 0.0f; ringVerts[vid++] = zo;
-        ringVerts[vid++] = 0.0f; ringVerts[vid++] = 1.0f; ringVerts[vid++] = 0.0f;
-        ringVerts[vid++] = 1.0f; ringVerts[vid++] = (float)i/(float)segments;
+// Fonte pronta para o glShaderSource (includes e defines resolvidos); sem '\0' no fim, use out->size.
+int loadShaderSource(const char* filePath, const char* defines, AssetView* out){
+    if (preprocessShader(filePath, defines, openAsset, out)) return 1;
+    printf("Falha ao carregar o shader: %s\n", filePath);
+    return 0;
+}
 
-        // inner
-        float xi = innerR * ca;
-        float zi = innerR * sa;
-        ringVerts[vid++] = xi; ringVerts[vid++] = 0.0f; ringVerts[vid++] = zi;
-        ringVerts[vid++] = 0.0f; ringVerts[vid++] = 1.0f; ringVerts[vid++] = 0.0f;
-        ringVerts[vid++] = 0.0f; ringVerts[vid++] = (float)i/(float)segments;
+// --- Cache de binários de programas (ARB_get_program_binary) ---
+// Programas linkados vão para cache/programas/<hash>.bin, chaveados pelas fontes e
+// por vendor/renderer/versão do driver. Um binário que o driver recusa (atualização,
+// outra GPU) é apagado e o programa é recompilado e gravado de novo. O glad do
+// projeto é 3.3 core: as três funções são carregadas à mão.
+#define PROGCACHE_DIR     "cache/programas"
+#define PROGCACHE_MAGIC   0x31475250u   // "PRG1"
+#define PROGCACHE_VERSION 1u
+
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH           0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS      0x87FE
+#endif
+
+typedef void (APIENTRYP ProgramBinaryGetFn)(GLuint, GLsizei, GLsizei*, GLenum*, void*);
+typedef void (APIENTRYP ProgramBinaryLoadFn)(GLuint, GLenum, const void*, GLsizei);
+typedef void (APIENTRYP ProgramParameterFn)(GLuint, GLenum, GLint);
+
+static ProgramBinaryGetFn  getProgramBinary;
+static ProgramBinaryLoadFn programBinary;
+static ProgramParameterFn  programParameteri;
+static uint64_t            programDriverHash;   // 0 = cache desligado
+
+typedef struct {
+    uint32_t magic, version;
+    uint64_t key;        // fontes + driver
+    uint32_t format;     // GLenum devolvido pelo driver
+    uint32_t length;     // bytes do binário logo após o cabeçalho
+} ProgramCacheHeader;
+
+int initProgramCache(void){
+    if (!glfwExtensionSupported("GL_ARB_get_program_binary")) return 0;
+    getProgramBinary  = (ProgramBinaryGetFn)glfwGetProcAddress("glGetProgramBinary");
+    programBinary     = (ProgramBinaryLoadFn)glfwGetProcAddress("glProgramBinary");
+    programParameteri = (ProgramParameterFn)glfwGetProcAddress("glProgramParameteri");
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    if (!getProgramBinary || !programBinary || !programParameteri || formats <= 0) return 0;
+    const char* strings[3] = {(const char*)glGetString(GL_VENDOR), (const char*)glGetString(GL_RENDERER),
+                              (const char*)glGetString(GL_VERSION)};
+    uint64_t h = HASH_SEED;
+    for (int i = 0; i < 3; ++i) if (strings[i]) h = hashBytes(strings[i], strlen(strings[i]) + 1, h);
+    programDriverHash = h ? h : 1;
+    return 1;
+}
+
+static uint64_t programCacheKey(const AssetView* vertexSource, const AssetView* fragmentSource){
+    const uint64_t info[2] = {PROGCACHE_VERSION, vertexSource->size};   // tamanho separa as duas fontes
+    uint64_t h = hashBytes(info, sizeof(info), programDriverHash);
+    h = hashBytes(vertexSource->data, vertexSource->size, h);
+    return hashBytes(fragmentSource->data, fragmentSource->size, h);
+}
+
+static uint64_t programContentKey(const AssetView* vertexSource, const AssetView* fragmentSource){
+    uint64_t vsSize = vertexSource->size;
+    return hashBytes(fragmentSource->data, fragmentSource->size,
+                     hashBytes(&vsSize, sizeof(vsSize), hashBytes(vertexSource->data, vertexSource->size, HASH_SEED)));
+}
+
+static void programCachePath(uint64_t key, char* out, size_t size){
+    snprintf(out, size, PROGCACHE_DIR "/%016llx.bin", (unsigned long long)key);
+}
+
+// Envia o binário em cache para 'prog' sem esperar o driver; 0 se não há arquivo
+// válido. Se o driver recusar, quem descobre é o finishProgram.
+static int issueCachedProgram(unsigned int prog, uint64_t key){
+    char path[300];
+    programCachePath(key, path, sizeof(path));
+    MappedFile mf;
+    if (!mapFile(path, &mf)) return 0;
+    const ProgramCacheHeader* hdr = (const ProgramCacheHeader*)mf.data;
+    int ok = mf.size >= sizeof(*hdr) && hdr->magic == PROGCACHE_MAGIC && hdr->version == PROGCACHE_VERSION
+          && hdr->key == key && sizeof(*hdr) + (size_t)hdr->length <= mf.size;
+    if (ok) programBinary(prog, (GLenum)hdr->format, mf.data + sizeof(*hdr), (GLsizei)hdr->length);   // o GL copia
+    unmapFile(&mf);
+    if (!ok){
+        printf("Aviso: binario de programa invalido, recompilando (%s)\n", path);
+        remove(path);
     }
-    *vertices = ringVerts;
+    return ok;
+}
 
-    *indexCount = (unsigned int)(segments * 6);
-    unsigned int* ringIndices = (unsigned int*)malloc((*indexCount) * sizeof(unsigned int));
-    int iid = 0;
-    for (int i = 0; i < segments; ++i){
-        unsigned int outer_i = (unsigned int)(i * 2);
-        unsigned int inner_i = outer_i + 1;
-        unsigned int outer_n = (unsigned int)(((i + 1) % segments) * 2);
-        unsigned int inner_n = outer_n + 1;
+static void storeCachedProgram(unsigned int prog, uint64_t key){
+    GLint length = 0;
+    glGetProgramiv(prog, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+    unsigned char* blob = (unsigned char*)malloc(sizeof(ProgramCacheHeader) + (size_t)length);
+    if (!blob) return;
+    GLenum format = 0;
+    GLsizei written = 0;
+    getProgramBinary(prog, length, &written, &format, blob + sizeof(ProgramCacheHeader));
+    ProgramCacheHeader hdr = {PROGCACHE_MAGIC, PROGCACHE_VERSION, key, (uint32_t)format, (uint32_t)written};
+    memcpy(blob, &hdr, sizeof(hdr));
+    char path[300];
+    programCachePath(key, path, sizeof(path));
+    makeDirs(PROGCACHE_DIR);
+    if (written > 0 && !writeFileAtomic(path, blob, sizeof(hdr) + (size_t)written))
+        printf("Aviso: nao foi possivel gravar o cache %s\n", path);
+    free(blob);
+}
 
-        ringIndices[iid++] = outer_i; ringIndices[iid++] = inner_i; ringIndices[iid++] = outer_n;
-        ringIndices[iid++] = inner_i; ringIndices[iid++] = inner_n; ringIndices[iid++] = outer_n;
+// --- Compilação não bloqueante ---
+// Compilar e linkar só enfileiram trabalho no driver; o que trava é a primeira
+// consulta de status. Por isso os programas são todos disparados de uma vez na
+// inicialização e o status só é lido quando o programa vai ser usado. Com
+// KHR/ARB_parallel_shader_compile o driver compila em threads próprias e
+// GL_COMPLETION_STATUS permite perguntar sem bloquear; sem a extensão a
+// consulta espera, mas só no primeiro quadro que precisa do programa — a
+// geração de malhas e a decodificação de texturas já correram em paralelo.
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+typedef void (APIENTRYP MaxCompilerThreadsFn)(GLuint);
+
+static int parallelShaderCompile;   // GL_COMPLETION_STATUS disponível
+
+int initParallelShaderCompile(void){
+    MaxCompilerThreadsFn maxThreads = NULL;
+    if (glfwExtensionSupported("GL_KHR_parallel_shader_compile"))
+        maxThreads = (MaxCompilerThreadsFn)glfwGetProcAddress("glMaxShaderCompilerThreadsKHR");
+    else if (glfwExtensionSupported("GL_ARB_parallel_shader_compile"))
+        maxThreads = (MaxCompilerThreadsFn)glfwGetProcAddress("glMaxShaderCompilerThreadsARB");
+    if (!maxThreads) return 0;
+    maxThreads(0xFFFFFFFFu);   // o driver escolhe quantas threads usar
+    parallelShaderCompile = 1;
+    return 1;
+}
+
+// Programa em construção: as fontes ficam abertas até o link terminar, para
+// recompilar no mesmo objeto se o driver recusar o binário do cache. Os shaders
+// também: o log de compilação só é lido se o link falhar (ler antes travaria).
+typedef struct ProgramBuild {
+    unsigned int id, vs, fs;
+    uint64_t cacheKey;       // 0 = cache de binários desligado
+    uint64_t contentKey;     // programContentKey das fontes
+    int fromBinary;
+    int pending;
+    int linked;
+    const char *vertexName, *fragmentName;   // só para as mensagens
+    AssetView vertexSource, fragmentSource;
+} ProgramBuild;
+
+static void issueShaderLink(ProgramBuild* b){
+    b->vs = glCreateShader(GL_VERTEX_SHADER);
+    const char* vsText = (const char*)b->vertexSource.data;
+    GLint vsLength = (GLint)b->vertexSource.size;
+    glShaderSource(b->vs, 1, &vsText, &vsLength);
+    glCompileShader(b->vs);
+
+    b->fs = glCreateShader(GL_FRAGMENT_SHADER);
+    const char* fsText = (const char*)b->fragmentSource.data;
+    GLint fsLength = (GLint)b->fragmentSource.size;
+    glShaderSource(b->fs, 1, &fsText, &fsLength);
+    glCompileShader(b->fs);
+
+    if (b->cacheKey) programParameteri(b->id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glAttachShader(b->id, b->vs); glAttachShader(b->id, b->fs); glLinkProgram(b->id);
+    b->fromBinary = 0;
+}
+
+static void deleteBuildShaders(ProgramBuild* b){
+    if (b->vs){ glDetachShader(b->id, b->vs); glDeleteShader(b->vs); }
+    if (b->fs){ glDetachShader(b->id, b->fs); glDeleteShader(b->fs); }
+    b->vs = b->fs = 0;
+}
+
+static void printShaderLog(unsigned int shader, const char* name){
+    GLint ok = 1;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &ok);
+    if (ok) return;
+    char log[1024];
+    glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+    printf("Falha ao compilar %s:\n%s\n", name, log);
+}
+
+// Dispara binário ou compilação; nada aqui espera o driver. Assume as fontes.
+static void beginProgram(ProgramBuild* b, const char* vertexName, const char* fragmentName,
+                         const AssetView* vertexSource, const AssetView* fragmentSource){
+    memset(b, 0, sizeof(*b));
+    b->vertexName = vertexName;
+    b->fragmentName = fragmentName;
+    b->vertexSource = *vertexSource;
+    b->fragmentSource = *fragmentSource;
+    b->cacheKey = programDriverHash ? programCacheKey(vertexSource, fragmentSource) : 0;
+    b->contentKey = programContentKey(vertexSource, fragmentSource);
+    b->id = glCreateProgram();
+    b->pending = 1;
+    b->fromBinary = b->cacheKey && issueCachedProgram(b->id, b->cacheKey);
+    if (!b->fromBinary) issueShaderLink(b);
+}
+
+// Conclui o programa se o driver já terminou; com wait, espera. 1 = pronto
+// (b->linked diz se deu certo; os erros já foram impressos).
+static int finishProgram(ProgramBuild* b, int wait){
+    if (!b->pending) return 1;
+    GLint done = 1;
+    if (parallelShaderCompile && !wait) glGetProgramiv(b->id, GL_COMPLETION_STATUS_KHR, &done);
+    if (!done) return 0;
+
+    GLint linked = 0;
+    glGetProgramiv(b->id, GL_LINK_STATUS, &linked);
+    if (!linked && b->fromBinary){
+        char path[300];
+        programCachePath(b->cacheKey, path, sizeof(path));
+        printf("Aviso: binario de programa recusado pelo driver, recompilando (%s)\n", path);
+        remove(path);
+        issueShaderLink(b);   // mesmo objeto: quem já tem o id não percebe
+        return finishProgram(b, wait);
     }
-    *indices = ringIndices;
+    if (!linked){
+        if (b->vs) printShaderLog(b->vs, b->vertexName);
+        if (b->fs) printShaderLog(b->fs, b->fragmentName);
+        char log[1024];
+        glGetProgramInfoLog(b->id, sizeof(log), NULL, log);
+        printf("Falha ao linkar o programa (%s + %s):\n%s\n", b->vertexName, b->fragmentName, log);
+    } else if (b->cacheKey && !b->fromBinary) storeCachedProgram(b->id, b->cacheKey);
+    deleteBuildShaders(b);
+    closeAsset(&b->vertexSource); closeAsset(&b->fragmentSource);
+    b->linked = linked != 0;
+    b->pending = 0;
+    return 1;
+}
+
+// Abandona uma construção em andamento, com ou sem o objeto de programa.
+static void discardBuild(ProgramBuild* b, int deleteProgram){
+    deleteBuildShaders(b);
+    if (b->pending){ closeAsset(&b->vertexSource); closeAsset(&b->fragmentSource); }
+    if (deleteProgram) glDeleteProgram(b->id);
+    free(b);
+}
+
+// Compila e espera (ferramentas e programas avulsos).
+unsigned int createShaderProgram(const char* vertexPath, const char* fragmentPath){
+    AssetView vertexSource, fragmentSource;
+    if (!loadShaderSource(vertexPath, NULL, &vertexSource)) return 0;
+    if (!loadShaderSource(fragmentPath, NULL, &fragmentSource)){ closeAsset(&vertexSource); return 0; }
+    ProgramBuild b;
+    beginProgram(&b, vertexPath, fragmentPath, &vertexSource, &fragmentSource);
+    finishProgram(&b, 1);
+    return b.id;
+}
+
+// Programas compartilhados, um por variante: o mesmo par de caminhos com os mesmos
+// defines nem relê as fontes; combinações diferentes que resultam no mesmo texto
+// reaproveitam o programa já linkado. Só as variantes pedidas são compiladas.
+static ResourceMap programsByPath, programsByContent, programsById;
+static ShaderProgram* programList;   // todos os compartilhados (hot reload percorre)
+
+ShaderProgram* acquireShaderProgram(const char* vertexPath, const char* fragmentPath, const char* defines){
+    if (!defines) defines = "";
+    uint64_t pathKey = hashBytes(fragmentPath, strlen(fragmentPath) + 1,
+                                 hashBytes(vertexPath, strlen(vertexPath) + 1, HASH_SEED));   // com o '\0' separando
+    pathKey = hashBytes(defines, strlen(defines), pathKey);
+    ShaderProgram* sp = (ShaderProgram*)resourceFind(&programsByPath, pathKey);
+    if (sp){ sp->refCount++; return sp; }
+
+    AssetView vertexSource, fragmentSource;
+    if (!loadShaderSource(vertexPath, defines, &vertexSource)) return NULL;
+    if (!loadShaderSource(fragmentPath, defines, &fragmentSource)){ closeAsset(&vertexSource); return NULL; }
+    uint64_t contentKey = programContentKey(&vertexSource, &fragmentSource);
+    sp = (ShaderProgram*)resourceFind(&programsByContent, contentKey);
+    if (sp){
+        sp->refCount++;
+        closeAsset(&vertexSource); closeAsset(&fragmentSource);
+    } else {
+        sp = (ShaderProgram*)calloc(1, sizeof(ShaderProgram));
+        snprintf(sp->vertexPath, sizeof(sp->vertexPath), "%s", vertexPath);
+        snprintf(sp->fragmentPath, sizeof(sp->fragmentPath), "%s", fragmentPath);
+        snprintf(sp->defines, sizeof(sp->defines), "%s", defines);
+        sp->pending = (ProgramBuild*)malloc(sizeof(ProgramBuild));
+        beginProgram(sp->pending, sp->vertexPath, sp->fragmentPath, &vertexSource, &fragmentSource);   // status só em shaderProgramReady
+        sp->id = sp->pending->id;
+        sp->refCount = 1;
+        sp->contentKey = contentKey;
+        sp->next = programList;
+        programList = sp;
+        resourceInsert(&programsByContent, contentKey, sp);
+        resourceInsert(&programsById, sp->id, sp);
+    }
+    resourceInsert(&programsByPath, pathKey, sp);
+    return sp;
+}
+
+int shaderProgramReady(unsigned int program){
+    ShaderProgram* sp = (ShaderProgram*)resourceFind(&programsById, program);
+    if (!sp || !sp->pending) return 1;   // avulsos já saem prontos
+    if (!finishProgram(sp->pending, 0)) return 0;
+    free(sp->pending);
+    sp->pending = NULL;
+    return 1;
+}
+
+void releaseShaderProgram(ShaderProgram* sp){
+    if (!sp || --sp->refCount > 0) return;
+    if (sp->pending) discardBuild(sp->pending, 0);
+    if (sp->reload) discardBuild(sp->reload, 1);
+    for (ShaderProgram** link = &programList; *link; link = &(*link)->next)
+        if (*link == sp){ *link = sp->next; break; }
+    resourceRemoveValue(&programsByPath, sp);
+    resourceRemove(&programsByContent, sp->contentKey);
+    resourceRemove(&programsById, sp->id);
+    glDeleteProgram(sp->id);
+    free(sp);
+}
+
+// --- Hot reload de shaders ---
+// Ferramenta de desenvolvimento, ligada só com --hot-reload. Editar um .glsl em
+// assets/shaders (ou em assets/shaders/include) recompila os programas afetados:
+// a nova versão é disparada num objeto à parte e só substitui a atual se linkar;
+// com erro, o log é impresso e o programa anterior continua. As fontes vêm sempre
+// dos arquivos soltos (o pacote é o que está sendo editado por fora). Qualquer
+// mudança reprocessa todos os programas e só recompila aqueles cujo texto final
+// mudou, o que cobre os includes sem manter um grafo de dependências. inotify no
+// Linux; nos demais sistemas, varredura periódica das datas de escrita.
+#define SHADER_WATCH_INTERVAL 0.5   // s entre varreduras (sem inotify)
+
+static int      shaderWatchFd = -1;
+static int      shaderWatchActive;
+static double   shaderWatchNext;
+static char     shaderWatchDir[256];
+static uint64_t shaderWatchStamp;   // caminhos + datas dos .glsl na última varredura
+
+static void startProgramReload(ShaderProgram* sp){
+    AssetView vertexSource, fragmentSource;
+    if (!preprocessShader(sp->vertexPath, sp->defines, openLooseAsset, &vertexSource)) return;   // no meio do salvamento: vem outro evento
+    if (!preprocessShader(sp->fragmentPath, sp->defines, openLooseAsset, &fragmentSource)){ closeAsset(&vertexSource); return; }
+    uint64_t contentKey = programContentKey(&vertexSource, &fragmentSource);
+    uint64_t building = sp->reload ? sp->reload->contentKey : sp->contentKey;
+    if (contentKey == building){ closeAsset(&vertexSource); closeAsset(&fragmentSource); return; }   // não afetado
+    if (sp->reload) discardBuild(sp->reload, 1);   // edição mais nova que a em andamento
+    sp->reload = (ProgramBuild*)malloc(sizeof(ProgramBuild));
+    beginProgram(sp->reload, sp->vertexPath, sp->fragmentPath, &vertexSource, &fragmentSource);
+}
+
+// Troca o programa atual pelo recompilado (ids mudam; quem guarda ShaderProgram* vê o novo).
+static void swapReloadedProgram(ShaderProgram* sp){
+    ProgramBuild* b = sp->reload;
+    sp->reload = NULL;
+    if (!b->linked){
+        printf("Shader com erro; mantendo a versao anterior (%s + %s)\n", sp->vertexPath, sp->fragmentPath);
+        discardBuild(b, 1);
+        return;
+    }
+    if (sp->pending){ discardBuild(sp->pending, 0); sp->pending = NULL; }
+    resourceRemove(&programsById, sp->id);
+    if (resourceFind(&programsByContent, sp->contentKey) == sp) resourceRemove(&programsByContent, sp->contentKey);
+    glDeleteProgram(sp->id);
+    sp->id = b->id;
+    sp->contentKey = b->contentKey;
+    resourceInsert(&programsById, sp->id, sp);
+    if (!resourceFind(&programsByContent, sp->contentKey)) resourceInsert(&programsByContent, sp->contentKey, sp);
+    printf("Shader recarregado: %s + %s%s%s\n", sp->vertexPath, sp->fragmentPath,
+           sp->defines[0] ? " / " : "", sp->defines);
+    free(b);
+}
+
+// Variantes que acabam com o mesmo texto dividem o programa (acquireShaderProgram): a edição vale para todas.
+static void reloadChangedPrograms(void){
+    for (ShaderProgram* sp = programList; sp; sp = sp->next) startProgramReload(sp);
+}
+
+static void stampShaderFile(const char* path, void* ctx){
+    size_t n = strlen(path);
+    if (n <= 5 || strcmp(path + n - 5, ".glsl")) return;
+    uint64_t* stamp = (uint64_t*)ctx;
+    uint64_t written = fileWriteTime(path);
+    *stamp = hashBytes(&written, sizeof(written), hashBytes(path, n, *stamp));
+}
+
+// Só datas e nomes (criar, apagar e renomear também mudam o resultado); o
+// pré-processamento fica para quando algo de fato mudou.
+static uint64_t shaderTreeStamp(void){
+    uint64_t stamp = HASH_SEED;
+    listFiles(shaderWatchDir, stampShaderFile, &stamp);
+    return stamp;
+}
+
+int startShaderHotReload(const char* dir){
+    shaderWatchActive = 1;
+    snprintf(shaderWatchDir, sizeof(shaderWatchDir), "%s", dir);
+#if defined(__linux__)
+    shaderWatchFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (shaderWatchFd >= 0 && inotify_add_watch(shaderWatchFd, dir, IN_CLOSE_WRITE | IN_MOVED_TO) < 0){
+        close(shaderWatchFd);
+        shaderWatchFd = -1;
+    }
+    if (shaderWatchFd >= 0){
+        char includeDir[300];
+        snprintf(includeDir, sizeof(includeDir), "%s/include", dir);
+        inotify_add_watch(shaderWatchFd, includeDir, IN_CLOSE_WRITE | IN_MOVED_TO);   // opcional
+    }
+#endif
+    if (shaderWatchFd < 0) shaderWatchStamp = shaderTreeStamp();
+    return shaderWatchFd >= 0;
+}
+
+void updateShaderHotReload(void){
+    if (!shaderWatchActive) return;
+    // Primeiro conclui o que foi disparado em quadros anteriores; o que muda agora
+    // só é consultado no próximo, dando ao driver ao menos um quadro de folga. Sem
+    // KHR/ARB_parallel_shader_compile não há como perguntar sem esperar: esse
+    // finishProgram compila e linka ali mesmo e o quadro seguinte à edição trava
+    // pelo tempo do link (aceitável numa ferramenta de desenvolvimento).
+    for (ShaderProgram* sp = programList; sp; sp = sp->next)
+        if (sp->reload && finishProgram(sp->reload, 0)) swapReloadedProgram(sp);
+
+#if defined(__linux__)
+    if (shaderWatchFd >= 0){
+        char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+        int changed = 0;
+        ssize_t len;
+        while ((len = read(shaderWatchFd, buf, sizeof(buf))) > 0){
+            for (char* p = buf; p < buf + len; ){
+                const struct inotify_event* ev = (const struct inotify_event*)p;
+                size_t n = ev->len ? strlen(ev->name) : 0;
+                if (n > 5 && !strcmp(ev->name + n - 5, ".glsl")) changed = 1;   // ignora temporários de editor
+                p += sizeof(struct inotify_event) + ev->len;
+            }
+        }
+        if (changed) reloadChangedPrograms();
+        return;
+    }
+#endif
+    double now = nowSeconds();
+    if (now < shaderWatchNext) return;
+    shaderWatchNext = now + SHADER_WATCH_INTERVAL;
+    uint64_t stamp = shaderTreeStamp();
+    if (stamp == shaderWatchStamp) return;
+    shaderWatchStamp = stamp;
+    reloadChangedPrograms();
+}
+
+// --- Cache de texturas pré-processadas ---
+// Cada imagem vira, na primeira execução, um arquivo cache/texturas/<hash>.tex com
+// os pixels prontos para o GL e toda a cadeia de mips (cabeçalho + offsets).
+// A chave é o hash do conteúdo do arquivo-fonte; nas execuções seguintes o
+// arquivo é só mapeado em memória e enviado nível a nível, sem decodificar.
+#define TEXCACHE_DIR        "cache/texturas"
+#define TEXCACHE_MAGIC      0x58455453u   // "STEX"
+#define TEXCACHE_VERSION    3u
+#define TEXCACHE_MAX_LEVELS TEXTURE_MAX_LEVELS
+
+typedef struct {
+    uint64_t offset, size;   // bytes a partir do início do arquivo
+    uint32_t width, height;
+} TexCacheLevel;
+
+typedef struct {
+    uint32_t magic, version;
+    uint64_t sourceHash;
+    uint32_t width, height, channels, levelCount;
+    uint32_t format;         // TEXFMT_RAW, TEXFMT_BC1 ou TEXFMT_BC3
+    uint32_t reserved;
+    TexCacheLevel levels[TEXCACHE_MAX_LEVELS];
+} TexCacheHeader;
+
+// --- Mipmaps na CPU (espaço linear) ---
+// Os níveis são filtrados em float linear (sRGB -> linear na entrada, de volta na
+// saída), com cor pré-multiplicada pelo alfa. Filtros separáveis box, Kaiser ou
+// Lanczos-3; cada nível parte do anterior ainda em float. Em texturas com alfa a
+// cobertura (fração acima de 0,5) do nível 0 é preservada nos níveis menores,
+// para os anéis não sumirem com a distância.
+#define MIP_FILTER_RADIUS 3.0f   // Kaiser e Lanczos, em pixels do nível de destino
+#define MIP_KAISER_BETA   4.0f
+#define MIP_COVERAGE_REF  0.5f
+
+static float         srgbToLinearLUT[256];
+static unsigned char linearToSrgbLUT[4096];
+
+void initColorLUTs(void){
+    for (int i = 0; i < 256; ++i){
+        float c = i / 255.0f;
+        srgbToLinearLUT[i] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+    }
+    for (int i = 0; i < 4096; ++i){
+        float l = i / 4095.0f;
+        float c = l <= 0.0031308f ? l * 12.92f : 1.055f * powf(l, 1.0f / 2.4f) - 0.055f;
+        linearToSrgbLUT[i] = (unsigned char)(c * 255.0f + 0.5f);
+    }
+}
+
+static float sincf(float x){
+    if (fabsf(x) < 1e-6f) return 1.0f;
+    x *= GLM_PIf;
+    return sinf(x) / x;
+}
+
+static float besselI0(float x){
+    float sum = 1.0f, term = 1.0f;
+    for (int k = 1; k < 16; ++k){ term *= (x * x) / (4.0f * k * k); sum += term; }
+    return sum;
+}
+
+static float mipFilterWeight(MipFilter f, float d){
+    float ad = fabsf(d);
+    switch (f){
+    case MIP_FILTER_BOX:
+        return ad < 0.5f ? 1.0f : (ad == 0.5f ? 0.5f : 0.0f);
+    case MIP_FILTER_LANCZOS:
+        return ad < MIP_FILTER_RADIUS ? sincf(d) * sincf(d / MIP_FILTER_RADIUS) : 0.0f;
+    case MIP_FILTER_KAISER:
+    default: {
+        if (ad >= MIP_FILTER_RADIUS) return 0.0f;
+        float r = d / MIP_FILTER_RADIUS;
+        return sincf(d) * besselI0(MIP_KAISER_BETA * sqrtf(1.0f - r * r)) / besselI0(MIP_KAISER_BETA);
+    }
+    }
+}
+
+// Pesos por pixel de destino (taps fixos; índices já com a borda repetida).
+typedef struct { int taps; int* index; float* weight; } FilterTable;
+
+static void buildFilterTable(FilterTable* ft, MipFilter f, int src, int dst){
+    float scale = (float)src / (float)dst;
+    float support = (f == MIP_FILTER_BOX ? 0.5f : MIP_FILTER_RADIUS) * scale;
+    ft->taps = (int)ceilf(support * 2.0f) + 1;
+    ft->index = (int*)malloc((size_t)dst * ft->taps * sizeof(int));
+    ft->weight = (float*)malloc((size_t)dst * ft->taps * sizeof(float));
+    for (int x = 0; x < dst; ++x){
+        float center = (x + 0.5f) * scale;
+        int first = (int)floorf(center - support);
+        float sum = 0.0f;
+        for (int t = 0; t < ft->taps; ++t){
+            int i = first + t;
+            float w = mipFilterWeight(f, (i + 0.5f - center) / scale);
+            ft->index[x * ft->taps + t] = i < 0 ? 0 : (i >= src ? src - 1 : i);
+            ft->weight[x * ft->taps + t] = w;
+            sum += w;
+        }
+        for (int t = 0; t < ft->taps; ++t) ft->weight[x * ft->taps + t] /= sum;
+    }
+}
+
+static void freeFilterTable(FilterTable* ft){ free(ft->index); free(ft->weight); }
+
+typedef struct {
+    const unsigned char* bytes;   // nível em 8 bits (entrada ou saída)
+    float* src;                   // RGBA linear pré-multiplicado
+    float* tmp;                   // após o passe horizontal (sh x dw)
+    float* dst;
+    int n, sw, sh, dw, dh;
+    int tmpRing, tmpBase;         // tmpRing > 0: tmp é um anel e a linha y da fonte é tmpBase + y
+    int dstBase;                  // primeira linha de destino em dst (faixas)
+    const FilterTable* fx;
+    const FilterTable* fy;
+    float alphaScale;
+    unsigned char* out;
+} MipJob;
+
+static void mipToLinearRows(void* arg, int begin, int end){
+    const MipJob* j = (const MipJob*)arg;
+    for (int y = begin; y < end; ++y){
+        const unsigned char* s = j->bytes + (size_t)y * j->sw * j->n;
+        float* d = j->src + (size_t)y * j->sw * 4;
+        for (int x = 0; x < j->sw; ++x, s += j->n, d += 4){
+            float a = (j->n == 2 || j->n == 4) ? s[j->n - 1] / 255.0f : 1.0f;
+            if (j->n >= 3){ d[0] = srgbToLinearLUT[s[0]] * a; d[1] = srgbToLinearLUT[s[1]] * a; d[2] = srgbToLinearLUT[s[2]] * a; }
+            else          { d[0] = d[1] = d[2] = srgbToLinearLUT[s[0]] * a; }
+            d[3] = a;
+        }
+    }
+}
+
+static void mipHorizontalRows(void* arg, int begin, int end){
+    const MipJob* j = (const MipJob*)arg;
+    const FilterTable* fx = j->fx;
+    for (int y = begin; y < end; ++y){
+        const float* s = j->src + (size_t)y * j->sw * 4;
+        float* d = j->tmp + (size_t)(j->tmpRing ? (j->tmpBase + y) % j->tmpRing : y) * j->dw * 4;
+        for (int x = 0; x < j->dw; ++x){
+            const int*   idx = fx->index + x * fx->taps;
+            const float* w   = fx->weight + x * fx->taps;
+#ifdef USE_SSE2
+            __m128 acc = _mm_setzero_ps();
+            for (int t = 0; t < fx->taps; ++t)
+                acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(w[t]), _mm_loadu_ps(s + idx[t] * 4)));
+            _mm_storeu_ps(d + x * 4, acc);
+#else
+            float acc[4] = {0, 0, 0, 0};
+            for (int t = 0; t < fx->taps; ++t)
+                for (int c = 0; c < 4; ++c) acc[c] += w[t] * s[idx[t] * 4 + c];
+            memcpy(d + x * 4, acc, sizeof(acc));
+#endif
+        }
+    }
+}
+
+static void mipVerticalRows(void* arg, int begin, int end){
+    const MipJob* j = (const MipJob*)arg;
+    const FilterTable* fy = j->fy;
+    int rowFloats = j->dw * 4;
+    for (int y = begin; y < end; ++y){
+        float* d = j->dst + (size_t)y * rowFloats;
+        memset(d, 0, (size_t)rowFloats * sizeof(float));
+        int row = j->dstBase + y;
+        for (int t = 0; t < fy->taps; ++t){
+            float w = fy->weight[row * fy->taps + t];
+            if (w == 0.0f) continue;
+            int src = fy->index[row * fy->taps + t];
+            const float* s = j->tmp + (size_t)(j->tmpRing ? src % j->tmpRing : src) * rowFloats;
+            int i = 0;
+#ifdef USE_SSE2
+            __m128 wv = _mm_set1_ps(w);
+            for (; i + 4 <= rowFloats; i += 4)
+                _mm_storeu_ps(d + i, _mm_add_ps(_mm_loadu_ps(d + i), _mm_mul_ps(wv, _mm_loadu_ps(s + i))));
+#endif
+            for (; i < rowFloats; ++i) d[i] += w * s[i];
+        }
+    }
+}
+
+static void mipToBytesRows(void* arg, int begin, int end){
+    const MipJob* j = (const MipJob*)arg;
+    int hasAlpha = (j->n == 2 || j->n == 4);
+    for (int y = begin; y < end; ++y){
+        const float* s = j->dst + (size_t)y * j->dw * 4;
+        unsigned char* d = j->out + (size_t)y * j->dw * j->n;
+        for (int x = 0; x < j->dw; ++x, s += 4, d += j->n){
+            float a = glm_clamp(s[3], 0.0f, 1.0f);
+            float inv = hasAlpha ? (a > 1e-6f ? 1.0f / a : 0.0f) : 1.0f;
+            int colors = j->n >= 3 ? 3 : 1;
+            for (int c = 0; c < colors; ++c)
+                d[c] = linearToSrgbLUT[(int)(glm_clamp(s[c] * inv, 0.0f, 1.0f) * 4095.0f + 0.5f)];
+            if (hasAlpha) d[j->n - 1] = (unsigned char)(glm_clamp(a * j->alphaScale, 0.0f, 1.0f) * 255.0f + 0.5f);
+        }
+    }
+}
+
+static float alphaCoverage(const float* rgba, size_t count, float scale){
+    size_t covered = 0;
+    for (size_t i = 0; i < count; ++i) covered += rgba[i * 4 + 3] * scale > MIP_COVERAGE_REF;
+    return (float)covered / (float)count;
+}
+
+// Preenche os níveis 1..N do container a partir do nível 0.
+static void generateMips(unsigned char* blob, MipFilter filter){
+    const TexCacheHeader* hdr = (const TexCacheHeader*)blob;
+    int n = (int)hdr->channels;
+    int hasAlpha = (n == 2 || n == 4);
+    const TexCacheLevel* l0 = &hdr->levels[0];
+
+    MipJob job;
+    memset(&job, 0, sizeof(job));
+    job.n = n;
+    job.sw = (int)l0->width; job.sh = (int)l0->height;
+    job.bytes = blob + l0->offset;
+    job.src = (float*)malloc((size_t)job.sw * job.sh * 4 * sizeof(float));
+    job.tmp = (float*)malloc((size_t)(job.sw / 2 + 1) * job.sh * 4 * sizeof(float));
+    job.dst = (float*)malloc((size_t)(job.sw / 2 + 1) * (job.sh / 2 + 1) * 4 * sizeof(float));
+    parallelFor(&workers, job.sh, 32, mipToLinearRows, &job);
+    float coverage = hasAlpha ? alphaCoverage(job.src, (size_t)job.sw * job.sh, 1.0f) : 0.0f;
+
+    for (uint32_t i = 1; i < hdr->levelCount; ++i){
+        const TexCacheLevel* lv = &hdr->levels[i];
+        job.dw = (int)lv->width; job.dh = (int)lv->height;
+        FilterTable fx, fy;
+        buildFilterTable(&fx, filter, job.sw, job.dw);
+        buildFilterTable(&fy, filter, job.sh, job.dh);
+        job.fx = &fx; job.fy = &fy;
+        parallelFor(&workers, job.sh, 16, mipHorizontalRows, &job);
+        parallelFor(&workers, job.dh, 16, mipVerticalRows, &job);
+
+        // Escala do alfa que mantém a cobertura do nível 0 (busca binária). Diferença
+        // menor que um pixel do nível não tem conserto: a escala fica em 1.
+        job.alphaScale = 1.0f;
+        size_t count = (size_t)job.dw * job.dh;
+        float current = hasAlpha && coverage > 0.0f ? alphaCoverage(job.dst, count, 1.0f) : coverage;
+        if (fabsf(current - coverage) >= 1.0f / (float)count){
+            // A cobertura cresce com a escala: busca só do lado de 1 que corrige o desvio,
+            // com cobertura(lo) < alvo <= cobertura(hi)
+            float lo = current < coverage ? 1.0f : 0.0f, hi = current < coverage ? 4.0f : 1.0f;
+            for (int it = 0; it < 12; ++it){
+                float mid = 0.5f * (lo + hi);
+                if (alphaCoverage(job.dst, count, mid) < coverage) lo = mid; else hi = mid;
+            }
+            // Fica o limite mais perto do alvo; no empate, o mais perto de 1
+            float below = coverage - alphaCoverage(job.dst, count, lo);
+            float above = alphaCoverage(job.dst, count, hi) - coverage;
+            job.alphaScale = below < above || (below == above && current < coverage) ? lo : hi;
+        }
+        job.out = blob + lv->offset;
+        parallelFor(&workers, job.dh, 32, mipToBytesRows, &job);
+        freeFilterTable(&fx);
+        freeFilterTable(&fy);
+
+        float* t = job.src; job.src = job.dst; job.dst = t;   // o nível novo vira a fonte
+        job.sw = job.dw; job.sh = job.dh;
+    }
+    free(job.src); free(job.tmp); free(job.dst);
+}
+
+// Redução no carregamento (presets de qualidade): o mesmo filtro e o mesmo espaço
+// linear dos mips, direto do tamanho original para o destino. A fonte passa para
+// float uma linha por vez, então o pico extra fica no resultado do passe horizontal.
+static void downsampleRows(void* arg, int begin, int end){
+    const MipJob* j = (const MipJob*)arg;
+    MipJob row = *j;
+    row.src = (float*)malloc((size_t)j->sw * 4 * sizeof(float));
+    if (!row.src) return;
+    for (int y = begin; y < end; ++y){
+        row.bytes = j->bytes + (size_t)y * j->sw * j->n;
+        row.tmp = j->tmp + (size_t)y * j->dw * 4;
+        mipToLinearRows(&row, 0, 1);
+        mipHorizontalRows(&row, 0, 1);
+    }
+    free(row.src);
+}
+
+static unsigned char* downsampleImage(const unsigned char* pixels, int w, int h, int n, int dw, int dh, MipFilter filter){
+    MipJob job;
+    memset(&job, 0, sizeof(job));
+    job.n = n;
+    job.sw = w; job.sh = h; job.dw = dw; job.dh = dh;
+    job.bytes = pixels;
+    job.alphaScale = 1.0f;
+    job.tmp = (float*)malloc((size_t)h * dw * 4 * sizeof(float));
+    job.dst = (float*)malloc((size_t)dw * dh * 4 * sizeof(float));
+    job.out = (unsigned char*)malloc((size_t)dw * dh * n);
+    if (!job.tmp || !job.dst || !job.out){
+        free(job.tmp); free(job.dst); free(job.out);
+        return NULL;
+    }
+    FilterTable fx, fy;
+    buildFilterTable(&fx, filter, w, dw);
+    buildFilterTable(&fy, filter, h, dh);
+    job.fx = &fx; job.fy = &fy;
+    parallelFor(&workers, h, 16, downsampleRows, &job);
+    parallelFor(&workers, dh, 16, mipVerticalRows, &job);
+    parallelFor(&workers, dh, 32, mipToBytesRows, &job);
+    freeFilterTable(&fx);
+    freeFilterTable(&fy);
+    free(job.tmp); free(job.dst);
+    return job.out;
+}
+
+// Metades (mantendo a proporção) até caber no maxTextureSize do preset.
+void fitTextureDims(int* w, int* h){
+    int cap = quality->maxTextureSize;
+    while (cap > 0 && (*w > cap || *h > cap)){
+        *w = *w > 1 ? *w / 2 : 1;
+        *h = *h > 1 ? *h / 2 : 1;
+    }
+}
+
+// Imagem reduzida (malloc) ou NULL se ela já cabe no preset.
+static unsigned char* fitTextureSize(const unsigned char* pixels, int* w, int* h, int n){
+    int dw = *w, dh = *h;
+    fitTextureDims(&dw, &dh);
+    if (dw == *w && dh == *h) return NULL;
+    unsigned char* out = downsampleImage(pixels, *w, *h, n, dw, dh, mipFilter);
+    if (out){ *w = dw; *h = dh; }
+    return out;
+}
+
+// Monta o container completo (cabeçalho + mips) em memória. Retorna NULL em erro.
+static unsigned char* buildTexCache(const unsigned char* pixels, int w, int h, int n,
+                                    uint64_t sourceHash, size_t* outSize){
+    TexCacheHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = TEXCACHE_MAGIC; hdr.version = TEXCACHE_VERSION; hdr.sourceHash = sourceHash;
+    hdr.width = (uint32_t)w; hdr.height = (uint32_t)h; hdr.channels = (uint32_t)n;
+
+    uint64_t offset = sizeof(TexCacheHeader);
+    int lw = w, lh = h;
+    for (;;){
+        TexCacheLevel* lv = &hdr.levels[hdr.levelCount++];
+        lv->width = (uint32_t)lw; lv->height = (uint32_t)lh;
+        lv->offset = offset;
+        lv->size = (uint64_t)lw * lh * n;
+        offset += (lv->size + 15) & ~(uint64_t)15;
+        if ((lw == 1 && lh == 1) || hdr.levelCount == TEXCACHE_MAX_LEVELS) break;
+        lw = lw > 1 ? lw / 2 : 1;
+        lh = lh > 1 ? lh / 2 : 1;
+    }
+
+    unsigned char* blob = (unsigned char*)calloc(1, (size_t)offset);
+    if (!blob) return NULL;
+    memcpy(blob, &hdr, sizeof(hdr));
+    memcpy(blob + hdr.levels[0].offset, pixels, (size_t)hdr.levels[0].size);
+    generateMips(blob, mipFilter);
+    *outSize = (size_t)offset;
+    return blob;
+}
+
+static int validTexCache(const unsigned char* data, size_t size, uint64_t sourceHash){
+    if (size < sizeof(TexCacheHeader)) return 0;
+    const TexCacheHeader* hdr = (const TexCacheHeader*)data;
+    if (hdr->magic != TEXCACHE_MAGIC || hdr->version != TEXCACHE_VERSION) return 0;
+    if (hdr->sourceHash != sourceHash) return 0;
+    if (hdr->levelCount == 0 || hdr->levelCount > TEXCACHE_MAX_LEVELS) return 0;
+    if (hdr->channels < 1 || hdr->channels > 4) return 0;
+    for (uint32_t i = 0; i < hdr->levelCount; ++i)
+        if (hdr->levels[i].offset + hdr->levels[i].size > size) return 0;
+    return 1;
+}
+
+// Grava em arquivo temporário e renomeia, para nunca deixar um cache pela metade.
+int writeFileAtomic(const char* path, const void* data, size_t size){
+    char tmp[300];
+    snprintf(tmp, sizeof(tmp), "%s.%p.tmp", path, (void*)&tmp);
+    FILE* f = fopen(tmp, "wb");
+    if (!f) return 0;
+    size_t written = fwrite(data, 1, size, f);
+    if (fclose(f) != 0 || written != size){ remove(tmp); return 0; }
+    if (!replaceFile(tmp, path)){ remove(tmp); return 0; }
+    return 1;
+}
+
+// --- Compressão BC1/BC3 (S3TC) ---
+// BC1 para mapas opacos (8 bytes por bloco 4x4), BC3 quando há alfa (16 bytes).
+// Eixo principal por PCA, índices pela menor distância à paleta (SSE2 quando
+// disponível) e um refinamento por mínimos quadrados dos extremos.
+#define TEXFMT_RAW 0u
+#define TEXFMT_BC1 1u
+#define TEXFMT_BC3 2u
+
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT  0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+static void expand565(uint16_t c, int out[3]){
+    int r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+    out[0] = (r << 3) | (r >> 2);
+    out[1] = (g << 2) | (g >> 4);
+    out[2] = (b << 3) | (b >> 2);
+}
+
+static uint16_t pack565(const float c[3]){
+    int r = (int)(glm_clamp(c[0], 0.0f, 255.0f) * 31.0f / 255.0f + 0.5f);
+    int g = (int)(glm_clamp(c[1], 0.0f, 255.0f) * 63.0f / 255.0f + 0.5f);
+    int b = (int)(glm_clamp(c[2], 0.0f, 255.0f) * 31.0f / 255.0f + 0.5f);
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+// Lê um bloco 4x4 como RGBA8 (bordas repetem o último pixel).
+static void fetchBlock(const unsigned char* src, int w, int h, int n, int bx, int by, unsigned char px[64]){
+    for (int y = 0; y < 4; ++y){
+        int sy = by * 4 + y < h ? by * 4 + y : h - 1;
+        for (int x = 0; x < 4; ++x){
+            int sx = bx * 4 + x < w ? bx * 4 + x : w - 1;
+            const unsigned char* s = src + ((size_t)sy * w + sx) * n;
+            unsigned char* d = px + (y * 4 + x) * 4;
+            if (n >= 3){ d[0] = s[0]; d[1] = s[1]; d[2] = s[2]; d[3] = n == 4 ? s[3] : 255; }
+            else       { d[0] = d[1] = d[2] = s[0]; d[3] = n == 2 ? s[1] : 255; }
+        }
+    }
+}
+
+static void bc1Palette(uint16_t c0, uint16_t c1, int pal[4][3]){
+    expand565(c0, pal[0]);
+    expand565(c1, pal[1]);
+    for (int c = 0; c < 3; ++c){
+        pal[2][c] = (2 * pal[0][c] + pal[1][c]) / 3;
+        pal[3][c] = (pal[0][c] + 2 * pal[1][c]) / 3;
+    }
+}
+
+// Índice (2 bits) da cor mais próxima de cada pixel; devolve o erro total.
+#ifdef USE_SSE2
+static uint32_t bc1Indices(const unsigned char px[64], const int pal[4][3], int* outError){
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i rgbMask = _mm_set1_epi32(0x00ffffff);   // ignora o alfa
+    __m128i dist[4][4];   // [cor da paleta][grupo de 4 pixels]
+    for (int k = 0; k < 4; ++k){
+        __m128i p16 = _mm_setr_epi16((short)pal[k][0], (short)pal[k][1], (short)pal[k][2], 0,
+                                     (short)pal[k][0], (short)pal[k][1], (short)pal[k][2], 0);
+        for (int g = 0; g < 4; ++g){
+            __m128i v  = _mm_and_si128(_mm_loadu_si128((const __m128i*)(px + g * 16)), rgbMask);
+            __m128i lo = _mm_sub_epi16(_mm_unpacklo_epi8(v, zero), p16);   // pixels 0,1
+            __m128i hi = _mm_sub_epi16(_mm_unpackhi_epi8(v, zero), p16);   // pixels 2,3
+            lo = _mm_madd_epi16(lo, lo);   // [r²+g², b², r²+g², b²]
+            hi = _mm_madd_epi16(hi, hi);
+            __m128i a = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(lo), _mm_castsi128_ps(hi), _MM_SHUFFLE(2, 0, 2, 0)));
+            __m128i b = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(lo), _mm_castsi128_ps(hi), _MM_SHUFFLE(3, 1, 3, 1)));
+            dist[k][g] = _mm_add_epi32(a, b);
+        }
+    }
+    uint32_t bits = 0;
+    int err = 0;
+    for (int g = 0; g < 4; ++g){
+        __m128i best = dist[0][g], idx = zero;
+        for (int k = 1; k < 4; ++k){
+            __m128i less = _mm_cmplt_epi32(dist[k][g], best);
+            best = _mm_or_si128(_mm_and_si128(less, dist[k][g]), _mm_andnot_si128(less, best));
+            idx  = _mm_or_si128(_mm_and_si128(less, _mm_set1_epi32(k)), _mm_andnot_si128(less, idx));
+        }
+        int32_t i4[4], e4[4];
+        _mm_storeu_si128((__m128i*)i4, idx);
+        _mm_storeu_si128((__m128i*)e4, best);
+        for (int j = 0; j < 4; ++j){ bits |= (uint32_t)i4[j] << ((g * 4 + j) * 2); err += e4[j]; }
+    }
+    if (outError) *outError = err;
+    return bits;
+}
+#else
+static uint32_t bc1Indices(const unsigned char px[64], const int pal[4][3], int* outError){
+    uint32_t bits = 0;
+    int err = 0;
+    for (int i = 0; i < 16; ++i){
+        const unsigned char* p = px + i * 4;
+        int best = 0x7fffffff, bestK = 0;
+        for (int k = 0; k < 4; ++k){
+            int dr = p[0] - pal[k][0], dg = p[1] - pal[k][1], db = p[2] - pal[k][2];
+            int d = dr*dr + dg*dg + db*db;
+            if (d < best){ best = d; bestK = k; }
+        }
+        bits |= (uint32_t)bestK << (i * 2);
+        err += best;
+    }
+    if (outError) *outError = err;
+    return bits;
+}
+#endif
+
+// Extremos iniciais: projeção no eixo principal (PCA por iteração de potência).
+static void bc1Endpoints(const unsigned char px[64], float e0[3], float e1[3]){
+    float mean[3] = {0, 0, 0};
+    for (int i = 0; i < 16; ++i) for (int c = 0; c < 3; ++c) mean[c] += px[i * 4 + c];
+    for (int c = 0; c < 3; ++c) mean[c] /= 16.0f;
+
+    float cov[6] = {0, 0, 0, 0, 0, 0};   // xx xy xz yy yz zz
+    for (int i = 0; i < 16; ++i){
+        float r = px[i*4] - mean[0], g = px[i*4+1] - mean[1], b = px[i*4+2] - mean[2];
+        cov[0] += r*r; cov[1] += r*g; cov[2] += r*b; cov[3] += g*g; cov[4] += g*b; cov[5] += b*b;
+    }
+    float axis[3] = {1.0f, 1.0f, 1.0f};
+    for (int it = 0; it < 8; ++it){
+        float x = cov[0]*axis[0] + cov[1]*axis[1] + cov[2]*axis[2];
+        float y = cov[1]*axis[0] + cov[3]*axis[1] + cov[4]*axis[2];
+        float z = cov[2]*axis[0] + cov[4]*axis[1] + cov[5]*axis[2];
+        float m = fmaxf(fabsf(x), fmaxf(fabsf(y), fabsf(z)));
+        if (m < 1e-6f) break;
+        axis[0] = x / m; axis[1] = y / m; axis[2] = z / m;
+    }
+    float len2 = axis[0]*axis[0] + axis[1]*axis[1] + axis[2]*axis[2];
+    float tmin = 0.0f, tmax = 0.0f;
+    for (int i = 0; i < 16; ++i){
+        float t = ((px[i*4] - mean[0]) * axis[0] + (px[i*4+1] - mean[1]) * axis[1] + (px[i*4+2] - mean[2]) * axis[2]) / len2;
+        if (t < tmin) tmin = t;
+        if (t > tmax) tmax = t;
+    }
+    float inset = (tmax - tmin) / 16.0f;   // recua um pouco: os extremos raramente são ótimos
+    tmin += inset; tmax -= inset;
+    for (int c = 0; c < 3; ++c){ e0[c] = mean[c] + axis[c] * tmax; e1[c] = mean[c] + axis[c] * tmin; }
+}
+
+// Reajusta os extremos por mínimos quadrados dados os índices atuais.
+static int bc1Refine(const unsigned char px[64], uint32_t bits, float e0[3], float e1[3]){
+    static const float w0[4] = {1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+    float aa = 0, ab = 0, bb = 0, ap[3] = {0, 0, 0}, bp[3] = {0, 0, 0};
+    for (int i = 0; i < 16; ++i){
+        float a = w0[(bits >> (i * 2)) & 3], b = 1.0f - a;
+        aa += a*a; ab += a*b; bb += b*b;
+        for (int c = 0; c < 3; ++c){ ap[c] += a * px[i*4+c]; bp[c] += b * px[i*4+c]; }
+    }
+    float det = aa * bb - ab * ab;
+    if (fabsf(det) < 1e-6f) return 0;
+    for (int c = 0; c < 3; ++c){
+        e0[c] = (ap[c] * bb - bp[c] * ab) / det;
+        e1[c] = (bp[c] * aa - ap[c] * ab) / det;
+    }
+    return 1;
+}
+
+static void encodeBC1Block(const unsigned char px[64], unsigned char out[8]){
+    float e0[3], e1[3];
+    bc1Endpoints(px, e0, e1);
+    uint16_t c0 = pack565(e0), c1 = pack565(e1);
+    int pal[4][3], err;
+    bc1Palette(c0, c1, pal);
+    uint32_t bits = bc1Indices(px, pal, &err);
+
+    if (bc1Refine(px, bits, e0, e1)){
+        uint16_t r0 = pack565(e0), r1 = pack565(e1);
+        int rpal[4][3], rerr;
+        bc1Palette(r0, r1, rpal);
+        uint32_t rbits = bc1Indices(px, rpal, &rerr);
+        if (rerr < err){ c0 = r0; c1 = r1; bits = rbits; }
+    }
+    // Modo de 4 cores exige c0 > c1; trocar os extremos troca 0<->1 e 2<->3.
+    if (c0 < c1){ uint16_t t = c0; c0 = c1; c1 = t; bits ^= 0x55555555u; }
+    else if (c0 == c1) bits = 0;
+
+    out[0] = (unsigned char)(c0 & 0xff); out[1] = (unsigned char)(c0 >> 8);
+    out[2] = (unsigned char)(c1 & 0xff); out[3] = (unsigned char)(c1 >> 8);
+    for (int i = 0; i < 4; ++i) out[4 + i] = (unsigned char)(bits >> (i * 8));
+}
+
+static void encodeBC3AlphaBlock(const unsigned char px[64], unsigned char out[8]){
+    int amin = 255, amax = 0;
+    for (int i = 0; i < 16; ++i){
+        int a = px[i * 4 + 3];
+        if (a < amin) amin = a;
+        if (a > amax) amax = a;
+    }
+    out[0] = (unsigned char)amax;
+    out[1] = (unsigned char)amin;
+    uint64_t bits = 0;
+    if (amax > amin){
+        // Paleta igualmente espaçada: posição na rampa (0=amax .. 7=amin) -> índice BC3
+        for (int i = 0; i < 16; ++i){
+            int r = ((amax - px[i * 4 + 3]) * 7 + (amax - amin) / 2) / (amax - amin);
+            uint64_t idx = r == 0 ? 0 : (r == 7 ? 1 : (uint64_t)(r + 1));
+            bits |= idx << (i * 3);
+        }
+    }
+    for (int i = 0; i < 6; ++i) out[2 + i] = (unsigned char)(bits >> (i * 8));
+}
+
+static void decodeBC1Block(const unsigned char in[8], unsigned char px[64], int fourColor){
+    uint16_t c0 = (uint16_t)(in[0] | (in[1] << 8)), c1 = (uint16_t)(in[2] | (in[3] << 8));
+    int pal[4][3];
+    bc1Palette(c0, c1, pal);
+    int alpha3 = 255;
+    if (!fourColor && c0 <= c1){
+        for (int c = 0; c < 3; ++c){ pal[2][c] = (pal[0][c] + pal[1][c]) / 2; pal[3][c] = 0; }
+        alpha3 = 0;
+    }
+    uint32_t bits = (uint32_t)in[4] | ((uint32_t)in[5] << 8) | ((uint32_t)in[6] << 16) | ((uint32_t)in[7] << 24);
+    for (int i = 0; i < 16; ++i){
+        int k = (bits >> (i * 2)) & 3;
+        for (int c = 0; c < 3; ++c) px[i * 4 + c] = (unsigned char)pal[k][c];
+        px[i * 4 + 3] = (unsigned char)(k == 3 ? alpha3 : 255);
+    }
+}
+
+static void decodeBC3Block(const unsigned char in[16], unsigned char px[64]){
+    decodeBC1Block(in + 8, px, 1);
+    int a[8] = {in[0], in[1]};
+    for (int i = 2; i < 8; ++i)
+        a[i] = a[0] > a[1] ? ((8 - i) * a[0] + (i - 1) * a[1]) / 7
+                           : (i < 6 ? ((6 - i) * a[0] + (i - 1) * a[1]) / 5 : (i == 6 ? 0 : 255));
+    uint64_t bits = 0;
+    for (int i = 0; i < 6; ++i) bits |= (uint64_t)in[2 + i] << (i * 8);
+    for (int i = 0; i < 16; ++i) px[i * 4 + 3] = (unsigned char)a[(bits >> (i * 3)) & 7];
+}
+
+typedef struct {
+    const unsigned char* src;
+    int w, h, n, blocksX;
+    unsigned char* dst;
+    uint32_t format;
+} BlockJob;
+
+static void encodeBlockRows(void* arg, int begin, int end){
+    const BlockJob* job = (const BlockJob*)arg;
+    size_t blockBytes = job->format == TEXFMT_BC3 ? 16 : 8;
+    unsigned char px[64];
+    for (int by = begin; by < end; ++by){
+        for (int bx = 0; bx < job->blocksX; ++bx){
+            unsigned char* out = job->dst + ((size_t)by * job->blocksX + bx) * blockBytes;
+            fetchBlock(job->src, job->w, job->h, job->n, bx, by, px);
+            if (job->format == TEXFMT_BC3){ encodeBC3AlphaBlock(px, out); out += 8; }
+            encodeBC1Block(px, out);
+        }
+    }
+}
+
+// Converte um container bruto (TEXFMT_RAW) para BC1 (RGB) ou BC3 (com alfa).
+static unsigned char* compressTexCache(const unsigned char* raw, size_t* outSize){
+    const TexCacheHeader* src = (const TexCacheHeader*)raw;
+    TexCacheHeader hdr = *src;
+    int hasAlpha = (src->channels == 2 || src->channels == 4);
+    hdr.format = hasAlpha ? TEXFMT_BC3 : TEXFMT_BC1;
+    size_t blockBytes = hasAlpha ? 16 : 8;
+
+    uint64_t offset = sizeof(TexCacheHeader);
+    for (uint32_t i = 0; i < hdr.levelCount; ++i){
+        TexCacheLevel* lv = &hdr.levels[i];
+        lv->offset = offset;
+        lv->size = (uint64_t)((lv->width + 3) / 4) * ((lv->height + 3) / 4) * blockBytes;
+        offset += (lv->size + 15) & ~(uint64_t)15;
+    }
+    unsigned char* blob = (unsigned char*)calloc(1, (size_t)offset);
+    if (!blob) return NULL;
+    memcpy(blob, &hdr, sizeof(hdr));
+    for (uint32_t i = 0; i < hdr.levelCount; ++i){
+        BlockJob job = { raw + src->levels[i].offset, (int)src->levels[i].width, (int)src->levels[i].height,
+                         (int)src->channels, (int)(hdr.levels[i].width + 3) / 4, blob + hdr.levels[i].offset, hdr.format };
+        parallelFor(&workers, (int)(hdr.levels[i].height + 3) / 4, 8, encodeBlockRows, &job);
+    }
+    *outSize = (size_t)offset;
+    return blob;
+}
+
+// --- Texturas assíncronas com streaming de mips ---
+// loadTexture2D devolve na hora uma textura com placeholder 1x1; os workers leem o
+// cache (ou decodificam e geram o cache) e streamTextures (thread do GL) envia os
+// níveis do mais grosso para o mais fino, respeitando streamBudgetBytes por quadro
+// e priorizando as texturas que mais cobrem a tela. GL_TEXTURE_BASE_LEVEL aponta
+// para o nível mais fino completo e GL_TEXTURE_MIN_LOD suaviza a troca.
+// Os bytes passam por um anel de PBOs: cópia para o buffer mapeado, glTexSubImage2D
+// a partir do buffer (o driver não copia de forma síncrona) e reaproveitamento do
+// PBO só depois que a fence do quadro em que foi usado sinaliza.
+//
+// Residência: cada textura só desce até o nível que seu tamanho na tela justifica
+// (desiredBase) e o total estimado fica abaixo de textureBudgetBytes. Para caber
+// um nível novo, saem primeiro os níveis mais finos das texturas vistas há mais
+// tempo ou menores na tela; se voltarem a ser necessários, são relidos do cache.
+#define MIP_FADE_SPEED 2.0f   // níveis por segundo
+#define EVICT_KEEP_LEVELS 5   // níveis mais grossos nunca descartados (16x8 e menores)
+#define UPLOAD_RING_SIZE 3
+#define UPLOAD_SLACK (64u * 1024u)   // folga para a linha forçada quando o orçamento acaba
+
+typedef struct {
+    GLuint buffer;
+    GLsync fence;      // sinaliza quando o GL terminou de ler este PBO
+    size_t capacity, used;
+} UploadBuffer;
+
+static UploadBuffer uploadRing[UPLOAD_RING_SIZE];
+static int          uploadCurrent = -1;
+
+// Escolhe o PBO do quadro. Retorna 0 se o próximo ainda está em uso (pula o quadro).
+static int stagingBegin(size_t bytes){
+    int next = (uploadCurrent + 1) % UPLOAD_RING_SIZE;
+    UploadBuffer* ub = &uploadRing[next];
+    if (ub->fence){
+        if (glClientWaitSync(ub->fence, 0, 0) == GL_TIMEOUT_EXPIRED) return 0;
+        glDeleteSync(ub->fence);
+        ub->fence = NULL;
+    }
+    if (!ub->buffer) glGenBuffers(1, &ub->buffer);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, ub->buffer);
+    if (ub->capacity < bytes){
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)bytes, NULL, GL_STREAM_DRAW);
+        ub->capacity = bytes;
+    }
+    ub->used = 0;
+    uploadCurrent = next;
+    return 1;
+}
+
+// Copia 'bytes' para o PBO atual; devolve o offset (usado como ponteiro pelo GL) ou NULL se não cabe.
+static const void* stagingPush(const void* src, size_t bytes, int* ok){
+    UploadBuffer* ub = &uploadRing[uploadCurrent];
+    *ok = 0;
+    if (ub->used + bytes > ub->capacity) return NULL;
+    void* dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, (GLintptr)ub->used, (GLsizeiptr)bytes,
+                                 GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (!dst) return NULL;
+    memcpy(dst, src, bytes);
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    const void* offset = (const void*)(uintptr_t)ub->used;
+    ub->used += (bytes + 15) & ~(size_t)15;
+    *ok = 1;
+    return offset;
+}
+
+static void stagingEnd(void){
+    UploadBuffer* ub = &uploadRing[uploadCurrent];
+    if (ub->used > 0) ub->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+static Mutex     texDoneLock;
+static Texture*  texDone;        // decodificações prontas aguardando streaming
+static Texture** textureList;    // todas as texturas criadas
+static int       textureCount, textureCapacity;
+static ResourceMap texturesByPath;      // hash do caminho -> Texture (inclui apelidos)
+static ResourceMap texturesByContent;   // hash do arquivo-fonte -> Texture (só com o pacote)
+static unsigned  frameIndex;
+
+// Miniaturas (cache/texturas/miniaturas.bin): o nível de até 8x8 de cada textura já
+// carregada, indexado pelo caminho. Servem de fallback de baixa resolução para
+// texturas ainda não pedidas, sem ler o arquivo-fonte nem o cache delas.
+#define THUMB_FILE    TEXCACHE_DIR "/miniaturas.bin"
+#define THUMB_MAGIC   0x424d4854u   // "THMB"
+#define THUMB_VERSION 1u
+#define THUMB_SIZE    8
+
+typedef struct {
+    uint64_t pathHash;
+    uint16_t width, height;
+    uint32_t reserved;
+    unsigned char rgba[THUMB_SIZE * THUMB_SIZE * 4];
+} Thumbnail;
+
+typedef struct { uint32_t magic, version, count, reserved; } ThumbnailHeader;
+
+static Thumbnail* thumbnails;
+static int        thumbnailCount, thumbnailCapacity;
+static int        thumbnailsLoaded, thumbnailsDirty;
+
+static void loadThumbnails(void){
+    thumbnailsLoaded = 1;
+    MappedFile mf;
+    if (!mapFile(THUMB_FILE, &mf)) return;
+    const ThumbnailHeader* hdr = (const ThumbnailHeader*)mf.data;
+    if (mf.size >= sizeof(*hdr) && hdr->magic == THUMB_MAGIC && hdr->version == THUMB_VERSION
+        && hdr->count > 0 && sizeof(*hdr) + (size_t)hdr->count * sizeof(Thumbnail) <= mf.size){
+        thumbnails = (Thumbnail*)malloc((size_t)hdr->count * sizeof(Thumbnail));
+        if (thumbnails){
+            thumbnailCount = thumbnailCapacity = (int)hdr->count;
+            memcpy(thumbnails, mf.data + sizeof(*hdr), (size_t)thumbnailCount * sizeof(Thumbnail));
+        }
+    }
+    unmapFile(&mf);
+}
+
+static Thumbnail* findThumbnail(uint64_t pathHash){
+    for (int i = 0; i < thumbnailCount; ++i)
+        if (thumbnails[i].pathHash == pathHash) return &thumbnails[i];
+    return NULL;
+}
+
+// Copia para 'th' o primeiro nível do cache que cabe em THUMB_SIZE (RGBA).
+static int extractThumbnail(const unsigned char* cache, Thumbnail* th){
+    const TexCacheHeader* hdr = (const TexCacheHeader*)cache;
+    int level = (int)hdr->levelCount - 1;
+    while (level > 0 && hdr->levels[level - 1].width <= THUMB_SIZE && hdr->levels[level - 1].height <= THUMB_SIZE) level--;
+    const TexCacheLevel* lv = &hdr->levels[level];
+    int w = (int)lv->width, h = (int)lv->height;
+    if (w > THUMB_SIZE || h > THUMB_SIZE) return 0;
+    const unsigned char* src = cache + lv->offset;
+    th->width = (uint16_t)w;
+    th->height = (uint16_t)h;
+    if (hdr->format == TEXFMT_RAW){
+        int n = (int)hdr->channels;
+        for (int i = 0; i < w * h; ++i){
+            const unsigned char* s = src + (size_t)i * n;
+            unsigned char* d = th->rgba + i * 4;
+            d[0] = s[0]; d[1] = n >= 3 ? s[1] : s[0]; d[2] = n >= 3 ? s[2] : s[0];
+            d[3] = (n == 2 || n == 4) ? s[n - 1] : 255;
+        }
+        return 1;
+    }
+    size_t blockBytes = hdr->format == TEXFMT_BC3 ? 16 : 8;
+    int blocksX = (w + 3) / 4;
+    unsigned char dec[64];
+    for (int by = 0; by < (h + 3) / 4; ++by){
+        for (int bx = 0; bx < blocksX; ++bx){
+            const unsigned char* blk = src + ((size_t)by * blocksX + bx) * blockBytes;
+            if (hdr->format == TEXFMT_BC3) decodeBC3Block(blk, dec);
+            else                          decodeBC1Block(blk, dec, 0);
+            for (int y = 0; y < 4 && by * 4 + y < h; ++y)
+                memcpy(th->rgba + ((size_t)(by * 4 + y) * w + bx * 4) * 4, dec + y * 16,
+                       (size_t)(w - bx * 4 < 4 ? w - bx * 4 : 4) * 4);
+        }
+    }
+    return 1;
+}
+
+static void rememberThumbnail(Texture* tex){
+    tex->thumbnailSaved = 1;
+    Thumbnail th;
+    memset(&th, 0, sizeof(th));
+    th.pathHash = hashBytes(tex->path, strlen(tex->path), HASH_SEED);
+    if (!extractThumbnail(tex->cache, &th)) return;
+    Thumbnail* old = findThumbnail(th.pathHash);
+    if (old && memcmp(old, &th, sizeof(th)) == 0) return;
+    if (!old){
+        if (thumbnailCount == thumbnailCapacity){
+            thumbnailCapacity = thumbnailCapacity ? thumbnailCapacity * 2 : 16;
+            thumbnails = (Thumbnail*)realloc(thumbnails, (size_t)thumbnailCapacity * sizeof(Thumbnail));
+        }
+        old = &thumbnails[thumbnailCount++];
+    }
+    *old = th;
+    thumbnailsDirty = 1;
+}
+
+void saveTextureThumbnails(void){
+    if (!thumbnailsDirty) return;
+    size_t size = sizeof(ThumbnailHeader) + (size_t)thumbnailCount * sizeof(Thumbnail);
+    unsigned char* blob = (unsigned char*)malloc(size);
+    if (!blob) return;
+    ThumbnailHeader hdr = {THUMB_MAGIC, THUMB_VERSION, (uint32_t)thumbnailCount, 0};
+    memcpy(blob, &hdr, sizeof(hdr));
+    memcpy(blob + sizeof(hdr), thumbnails, (size_t)thumbnailCount * sizeof(Thumbnail));
+    makeDirs(TEXCACHE_DIR);
+    if (!writeFileAtomic(THUMB_FILE, blob, size)) printf("Aviso: nao foi possivel gravar %s\n", THUMB_FILE);
+    else thumbnailsDirty = 0;
+    free(blob);
+}
+
+// Caches sendo montados agora. Sem o pacote, cópias de um arquivo com caminhos
+// diferentes só se revelam aqui (o hash sai do arquivo já mapeado): a segunda
+// espera a primeira terminar e mapeia o mesmo cache em vez de decodificar de novo.
+static Mutex    texBuildLock;
+static Cond     texBuildDone;
+static uint64_t texBuilding[POOL_MAX_THREADS];
+
+// Reserva a montagem de 'hash' (esperando quem já a faz). 1 = esperou: tente o cache de novo.
+static int claimTexBuild(uint64_t hash){
+    int waited = 0, slot = -1;
+    mutexLock(&texBuildLock);
+    for (;;){
+        int busy = 0;
+        slot = -1;
+        for (int i = 0; i < POOL_MAX_THREADS; ++i){
+            if (texBuilding[i] == hash) busy = 1;
+            else if (!texBuilding[i] && slot < 0) slot = i;
+        }
+        if (!busy && slot >= 0) break;
+        waited = 1;
+        condWait(&texBuildDone, &texBuildLock);
+    }
+    texBuilding[slot] = hash;
+    mutexUnlock(&texBuildLock);
+    return waited;
+}
+
+static void releaseTexBuild(uint64_t hash){
+    mutexLock(&texBuildLock);
+    for (int i = 0; i < POOL_MAX_THREADS; ++i)
+        if (texBuilding[i] == hash){ texBuilding[i] = 0; break; }
+    condBroadcast(&texBuildDone);
+    mutexUnlock(&texBuildLock);
+}
+
+static void decodeTextureJob(void* arg){
+    Texture* tex = (Texture*)arg;
+    AssetView src = {0};
+    if (tex->procedural || openAsset(tex->path, &src)){
+        const uint32_t keyInfo[4] = {TEXCACHE_VERSION, (uint32_t)texCompression, (uint32_t)mipFilter,
+                                     (uint32_t)quality->maxTextureSize};
+        // Conteúdo do pacote ou, solto, do arquivo já mapeado (uma leitura só)
+        uint64_t content = tex->procedural ? hashBytes(tex->procedural, sizeof(ProceduralParams), HASH_SEED)
+                         : tex->contentKey ? tex->contentKey : hashBytes(src.data, src.size, HASH_SEED);
+        uint64_t hash = hashBytes(keyInfo, sizeof(keyInfo), content);
+        char cachePath[300];
+        snprintf(cachePath, sizeof(cachePath), TEXCACHE_DIR "/%016llx.tex", (unsigned long long)hash);
+
+        int cached = mapFile(cachePath, &tex->map) && validTexCache(tex->map.data, tex->map.size, hash);
+        int claimed = !cached;
+        if (!cached){
+            unmapFile(&tex->map);
+            if (claimTexBuild(hash)){   // outra cópia do arquivo estava montando o mesmo cache
+                cached = mapFile(cachePath, &tex->map) && validTexCache(tex->map.data, tex->map.size, hash);
+                if (!cached) unmapFile(&tex->map);
+            }
+        }
+        if (cached){
+            tex->cache = tex->map.data;
+        } else {
+            int w, h, n = 3;
+            size_t size = 0;
+            unsigned char* pixels;
+            if (tex->procedural){
+                double t0 = nowSeconds();
+                pixels = generateProceduralTexture(tex->procedural, &w, &h);
+                double ms = (nowSeconds() - t0) * 1000.0;
+                if (pixels) printf("Textura %s: %dx%d gerada em %.1f ms (%.2f ms/MP)\n", tex->path, w, h,
+                                   ms, ms / ((double)w * h / 1e6));
+                if (pixels) tex->owned = buildTexCache(pixels, w, h, n, hash, &size);
+                free(pixels);
+            } else {
+                decodeArenaBegin();
+                pixels = decodeImage(src.data, src.size, &w, &h, &n);
+                if (pixels){
+                    unsigned char* fitted = fitTextureSize(pixels, &w, &h, n);   // NULL: já cabe
+                    tex->owned = buildTexCache(fitted ? fitted : pixels, w, h, n, hash, &size);
+                    free(fitted);
+                }
+                stbi_image_free(pixels);
+                tex->decodePeakBytes = decodeArenaEnd();
+                if (pixels) printf("Textura %s: %dx%d, pico da decodificacao %.1f MB\n", tex->path, w, h,
+                                   tex->decodePeakBytes / (1024.0 * 1024.0));
+            }
+            if (tex->owned && texCompression){
+                unsigned char* bc = compressTexCache(tex->owned, &size);
+                free(tex->owned);
+                tex->owned = bc;
+            }
+            if (tex->owned){
+                tex->cache = tex->owned;
+                makeDirs(TEXCACHE_DIR);
+                if (!writeFileAtomic(cachePath, tex->owned, size))
+                    printf("Aviso: nao foi possivel gravar o cache %s\n", cachePath);
+            }
+        }
+        if (claimed) releaseTexBuild(hash);
+        closeAsset(&src);
+    }
+    mutexLock(&texDoneLock);
+    tex->next = texDone;
+    texDone = tex;
+    mutexUnlock(&texDoneLock);
+}
+
+// Caminhos já vistos devolvem a mesma textura; no pacote, caminhos novos com o mesmo
+// conteúdo (cópias do arquivo) viram apelidos dela. Arquivos soltos não são lidos
+// aqui: cópias deles dividem o cache em decodeTextureJob. Cada chamada pede um releaseTexture.
+Texture* loadTexture2D(const char* path){
+    static int lockReady = 0;
+    if (!lockReady){
+        mutexInit(&texDoneLock);
+        mutexInit(&texBuildLock);
+        condInit(&texBuildDone);
+        lockReady = 1;
+    }
+
+    if (!thumbnailsLoaded) loadThumbnails();
+
+    uint64_t pathKey = hashBytes(path, strlen(path), HASH_SEED);
+    Texture* tex = (Texture*)resourceFind(&texturesByPath, pathKey);
+    if (tex){ tex->refCount++; return tex; }
+    uint64_t contentKey = 0;
+    if (assetContentHash(path, &contentKey) && (tex = (Texture*)resourceFind(&texturesByContent, contentKey))){
+        tex->refCount++;
+        resourceInsert(&texturesByPath, pathKey, tex);
+        return tex;
+    }
+
+    tex = (Texture*)calloc(1, sizeof(Texture));
+    snprintf(tex->path, sizeof(tex->path), "%s", path);
+    tex->refCount = 1;
+    tex->contentKey = contentKey;
+    resourceInsert(&texturesByPath, pathKey, tex);
+    if (contentKey) resourceInsert(&texturesByContent, contentKey, tex);
+    tex->state = TEX_IDLE;   // decodificação só quando ficar visível (streamTextures)
+
+    glGenTextures(1, &tex->id);
+    tex->streamId = tex->id;
+    glBindTexture(GL_TEXTURE_2D, tex->id);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);	
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    const Thumbnail* th = findThumbnail(hashBytes(tex->path, strlen(tex->path), HASH_SEED));
+    const unsigned char placeholder[4] = {40, 40, 48, 255};
+    if (th) glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, th->width, th->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, th->rgba);
+    else    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder);
+
+    if (textureCount == textureCapacity){
+        textureCapacity = textureCapacity ? textureCapacity * 2 : 16;
+        textureList = (Texture**)realloc(textureList, textureCapacity * sizeof(Texture*));
+    }
+    textureList[textureCount++] = tex;
+    return tex;
+}
+
+// Tira a textura dos caches (todos os caminhos que apontam para ela).
+static void forgetTexture(Texture* tex){
+    resourceRemoveValue(&texturesByPath, tex);
+    if (tex->contentKey && resourceFind(&texturesByContent, tex->contentKey) == tex)
+        resourceRemove(&texturesByContent, tex->contentKey);
+}
+
+static void destroyTexture(Texture* tex){
+    if (tex->streamId != tex->id) glDeleteTextures(1, &tex->streamId);
+    glDeleteTextures(1, &tex->id);
+    unmapFile(&tex->map);
+    free(tex->owned);
+    free(tex->procedural);
+    for (int i = 0; i < textureCount; ++i)
+        if (textureList[i] == tex){ textureList[i] = textureList[--textureCount]; break; }
+    free(tex);
+}
+
+void releaseTexture(Texture* tex){
+    if (!tex || --tex->refCount > 0) return;
+    forgetTexture(tex);
+    if (tex->state == TEX_DECODING) tex->released = 1;   // o worker ainda usa; streamTextures destrói
+    else destroyTexture(tex);
+}
+
+// Troca a imagem de uma textura em tempo de execução (ex.: outro conjunto de mapas).
+// Os níveis novos vão para um objeto GL separado e só substituem o atual quando
+// completos, então a imagem antiga continua na tela sem engasgos. A textura pode
+// estar compartilhada: todos que a carregaram passam a ver a imagem nova.
+int reloadTexture2D(Texture* tex, const char* path){
+    if (tex->state == TEX_DECODING || tex->state == TEX_STREAMING) return 0;
+    forgetTexture(tex);
+    snprintf(tex->path, sizeof(tex->path), "%s", path);
+    if (!assetContentHash(path, &tex->contentKey)) tex->contentKey = 0;
+    uint64_t pathKey = hashBytes(path, strlen(path), HASH_SEED);
+    if (!resourceFind(&texturesByPath, pathKey)) resourceInsert(&texturesByPath, pathKey, tex);
+    if (tex->contentKey && !resourceFind(&texturesByContent, tex->contentKey))
+        resourceInsert(&texturesByContent, tex->contentKey, tex);
+    tex->thumbnailSaved = 0;
+    if (tex->state == TEX_IDLE) return 1;   // ainda não pedida: carrega a nova quando aparecer
+    tex->state = TEX_DECODING;
+    glGenTextures(1, &tex->streamId);
+    glBindTexture(GL_TEXTURE_2D, tex->streamId);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    jobPoolSubmit(&workers, decodeTextureJob, tex);
+    return 1;
+}
+
+void textureUsed(Texture* tex, float coveragePx){
+    if (tex) tex->priority += coveragePx;
+}
+
+// Nível mais fino útil: ~2,5 texels por pixel da raiz da cobertura (o mapa dá a
+// volta na esfera, só metade dele aparece no diâmetro visível).
+static int desiredLevelFor(const Texture* t, float coveragePx){
+    float need = 2.5f * sqrtf(coveragePx);
+    int level = 0;
+    while (level < t->levelCount - 1 && (float)(t->width >> (level + 1)) >= need) level++;
+    int skip = quality->skipMips < t->levelCount - 1 ? quality->skipMips : t->levelCount - 1;
+    return level > skip ? level : skip;   // preset: os níveis mais finos nunca sobem
+}
+
+// VRAM estimada da textura: níveis residentes + nível em envio (já alocado) +
+// o objeto antigo de uma recarga ainda não trocada.
+static size_t textureBytes(const Texture* t){
+    size_t total = t->retiredBytes;
+    for (int l = t->residentBase; l < t->levelCount; ++l) total += t->levelBytes[l];
+    if (t->uploadRow > 0) total += t->levelBytes[t->residentBase - 1];
+    return total;
+}
+
+size_t textureMemoryUsed(void){
+    size_t total = 0;
+    for (int i = 0; i < textureCount; ++i) total += textureBytes(textureList[i]);
+    return total;
+}
+
+// Estimativa sem decodificar (só os cabeçalhos das imagens): nível 0 limitado pelo
+// preset, sem os skipMips mais finos, BC1/BC3 ou 4 bytes/pixel como textureBytes.
+size_t projectedTextureBytes(void){
+    size_t total = 0;
+    for (int i = 0; i < textureCount; ++i){
+        const Texture* t = textureList[i];
+        int w, h, n;
+        if (t->procedural){
+            w = (int)t->procedural->width; h = w / 2; n = 3;
+        } else {
+            AssetView src;
+            if (!openAsset(t->path, &src)) continue;
+            int ok = stbi_info_from_memory(src.data, (int)src.size, &w, &h, &n);
+            closeAsset(&src);
+            if (!ok) continue;
+        }
+        fitTextureDims(&w, &h);
+        int hasAlpha = (n == 2 || n == 4);
+        for (int level = 0; level < TEXCACHE_MAX_LEVELS; ++level){
+            if (level >= quality->skipMips || (w == 1 && h == 1))
+                total += texCompression ? (size_t)((w + 3) / 4) * ((h + 3) / 4) * (hasAlpha ? 16 : 8)
+                                        : (size_t)w * h * 4;
+            if (w == 1 && h == 1) break;
+            w = w > 1 ? w / 2 : 1;
+            h = h > 1 ? h / 2 : 1;
+        }
+    }
+    return total;
+}
+
+// 'a' sai antes de 'b': vista há mais tempo ou, empatando, menor na tela.
+static int lessImportant(const Texture* a, const Texture* b){
+    if (a->lastVisibleFrame != b->lastVisibleFrame) return a->lastVisibleFrame < b->lastVisibleFrame;
+    return a->coverage < b->coverage;
+}
+
+static int canEvict(const Texture* t){
+    return t->levelCount > 0 && (t->uploadRow > 0 || t->residentBase < t->levelCount - EVICT_KEEP_LEVELS);
+}
+
+// Descarta o nível em envio ou, se não houver, o nível residente mais fino.
+static size_t evictFinestLevel(Texture* t){
+    glBindTexture(GL_TEXTURE_2D, t->streamId);
+    int level = t->uploadRow > 0 ? t->residentBase - 1 : t->residentBase;
+    if (t->uploadRow > 0){
+        t->uploadRow = 0;
+    } else {
+        t->residentBase = level + 1;
+        if (t->minLod < (float)t->residentBase) t->minLod = (float)t->residentBase;
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, t->residentBase);
+        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_LOD, t->minLod - (float)t->residentBase);
+    }
+    // Fora de [BASE_LEVEL, MAX_LEVEL] o nível não conta para a completude; 0x0 devolve a memória.
+    glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    return t->levelBytes[level];
+}
+
+// Abre espaço para mais 'bytes' descartando níveis de texturas menos importantes
+// que 'requester' (NULL = qualquer uma). Retorna 0 se não houver o que descartar.
+static int makeTextureRoom(size_t bytes, const Texture* requester){
+    size_t used = textureMemoryUsed();
+    while (used + bytes > textureBudgetBytes){
+        Texture* victim = NULL;
+        for (int i = 0; i < textureCount; ++i){
+            Texture* t = textureList[i];
+            if (t == requester || !canEvict(t)) continue;
+            if (requester && !lessImportant(t, requester)) continue;
+            if (!victim || lessImportant(t, victim)) victim = t;
+        }
+        if (!victim) return 0;
+        used -= evictFinestLevel(victim);
+    }
+    return 1;
+}
+
+// Envia linhas do próximo nível (mais fino que o residente) até gastar 'budget'
+// bytes. Um nível só passa a ser amostrado quando chega inteiro.
+static size_t streamTextureLevels(Texture* tex, size_t budget){
+    const TexCacheHeader* hdr = (const TexCacheHeader*)tex->cache;
+    int compressed = hdr->format != TEXFMT_RAW;
+    GLenum fmt = (hdr->channels == 4 ? GL_RGBA : GL_RGB);
+    GLenum bcFmt = (hdr->format == TEXFMT_BC3 ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT);
+    size_t spent = 0;
+
+    glBindTexture(GL_TEXTURE_2D, tex->streamId);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    while (tex->residentBase > tex->desiredBase){
+        int level = tex->residentBase - 1;
+        const TexCacheLevel* lv = &hdr->levels[level];
+        GLsizei w = (GLsizei)lv->width, h = (GLsizei)lv->height;
+        int rowsPerUnit = compressed ? 4 : 1;   // BC: uma "linha" é uma linha de blocos
+        int units = (h + rowsPerUnit - 1) / rowsPerUnit;
+        size_t unitBytes = (size_t)(lv->size / (uint64_t)units);
+
+        size_t left = budget > spent ? budget - spent : 0;
+        int n = (int)(left / unitBytes);
+        if (n == 0){
+            if (spent > 0) break;
+            n = 1;   // sempre progride ao menos uma linha por quadro
+        }
+        if (n > units - tex->uploadRow) n = units - tex->uploadRow;
+
+        if (tex->uploadRow == 0){   // aloca o nível inteiro antes das faixas
+            if (!makeTextureRoom(tex->levelBytes[level], tex)) break;
+            if (compressed) glCompressedTexImage2D(GL_TEXTURE_2D, level, bcFmt, w, h, 0, (GLsizei)lv->size, NULL);
+            else            glTexImage2D(GL_TEXTURE_2D, level, fmt, w, h, 0, fmt, GL_UNSIGNED_BYTE, NULL);
+        }
+        GLint   y  = tex->uploadRow * rowsPerUnit;
+        GLsizei rh = n * rowsPerUnit < h - y ? n * rowsPerUnit : h - y;
+        int staged;
+        const void* data = stagingPush(tex->cache + lv->offset + (size_t)tex->uploadRow * unitBytes, (size_t)n * unitBytes, &staged);
+        if (!staged) break;   // PBO do quadro cheio
+        if (compressed) glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, y, w, rh, bcFmt, (GLsizei)(n * unitBytes), data);
+        else            glTexSubImage2D(GL_TEXTURE_2D, level, 0, y, w, rh, fmt, GL_UNSIGNED_BYTE, data);
+        spent += (size_t)n * unitBytes;
+        tex->uploadRow += n;
+
+        if (tex->uploadRow == units){
+            if (tex->residentBase == tex->levelCount){   // primeiro nível real: sai do placeholder
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, tex->levelCount - 1);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+                tex->minLod = (float)level;
+            }
+            tex->residentBase = level;
+            tex->uploadRow = 0;
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+            glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_LOD, tex->minLod - (float)level);
+        }
+    }
+    return spent;
+}
+
+static int compareTexturePriority(const void* a, const void* b){
+    float pa = (*(Texture* const*)a)->priority, pb = (*(Texture* const*)b)->priority;
+    return (pa < pb) - (pa > pb);
+}
+
+// Chamado uma vez por quadro. Retorna quantas texturas ainda não estão completas.
+int streamTextures(void){
+    mutexLock(&texDoneLock);
+    Texture* tex = texDone;
+    texDone = NULL;
+    mutexUnlock(&texDoneLock);
+    for (Texture* next; tex; tex = next){
+        next = tex->next;
+        if (tex->released){ destroyTexture(tex); continue; }
+        if (!tex->cache){
+            printf("Falha ao carregar textura: %s\n", tex->path);
+            tex->state = TEX_FAILED;
+            continue;
+        }
+        const TexCacheHeader* hdr = (const TexCacheHeader*)tex->cache;
+        // Recarga de níveis descartados mantém o que já está no GL
+        int refill = tex->levelCount == (int)hdr->levelCount && tex->streamId == tex->id
+                  && tex->residentBase < tex->levelCount;
+        // Recarga: os níveis do objeto antigo seguem na GPU até a troca
+        if (tex->streamId != tex->id) tex->retiredBytes = textureBytes(tex);
+        tex->state = TEX_STREAMING;
+        tex->levelCount = (int)hdr->levelCount;
+        tex->width = (int)hdr->width;
+        for (int l = 0; l < tex->levelCount; ++l)   // RGB costuma ocupar 4 bytes/pixel na GPU
+            tex->levelBytes[l] = hdr->format != TEXFMT_RAW ? (size_t)hdr->levels[l].size
+                               : (size_t)hdr->levels[l].width * hdr->levels[l].height * 4;
+        if (!refill){
+            tex->residentBase = tex->levelCount;   // nada residente ainda
+            tex->uploadRow = 0;
+        }
+        if (!tex->thumbnailSaved) rememberThumbnail(tex);
+    }
+
+    // Visibilidade do quadro anterior: nível desejado, LRU e recarga sob demanda
+    frameIndex++;
+    for (int i = 0; i < textureCount; ++i){
+        Texture* t = textureList[i];
+        if (t->priority <= 0.0f) continue;
+        if (t->state == TEX_IDLE){   // primeira vez grande o bastante na tela
+            if (t->priority < TEXTURE_REQUEST_MIN_PX) continue;
+            t->state = TEX_DECODING;
+            jobPoolSubmit(&workers, decodeTextureJob, t);
+        }
+        t->lastVisibleFrame = frameIndex;
+        t->coverage = t->priority;
+        if (t->levelCount > 0) t->desiredBase = desiredLevelFor(t, t->priority);
+        if (t->state == TEX_RESIDENT && t->desiredBase < t->residentBase){
+            t->state = TEX_DECODING;
+            jobPoolSubmit(&workers, decodeTextureJob, t);
+        }
+    }
+
+    static Texture** order;
+    static int orderCapacity;
+    if (orderCapacity < textureCount){
+        orderCapacity = textureCapacity;
+        order = (Texture**)realloc(order, orderCapacity * sizeof(Texture*));
+    }
+    int pending = 0, count = 0;
+    for (int i = 0; i < textureCount; ++i){
+        Texture* t = textureList[i];
+        if (t->state == TEX_STREAMING && t->residentBase > t->desiredBase) order[count++] = t;
+        if (t->state == TEX_STREAMING || t->state == TEX_DECODING) pending++;
+    }
+    qsort(order, count, sizeof(Texture*), compareTexturePriority);
+
+    if (count > 0 && stagingBegin(streamBudgetBytes + UPLOAD_SLACK)){
+        size_t spent = 0;
+        for (int i = 0; i < count && spent < streamBudgetBytes; ++i)
+            spent += streamTextureLevels(order[i], streamBudgetBytes - spent);
+        stagingEnd();
+    }
+
+    for (int i = 0; i < textureCount; ++i){
+        Texture* t = textureList[i];
+        t->priority = 0.0f;
+        if (t->state != TEX_STREAMING || t->residentBase == t->levelCount) continue;
+        float target = (float)t->residentBase;
+        if (t->minLod > target){
+            // numa recarga o objeto novo ainda não aparece: não há o que suavizar
+            t->minLod = t->streamId != t->id ? target : fmaxf(target, t->minLod - MIP_FADE_SPEED * deltaTime);
+            glBindTexture(GL_TEXTURE_2D, t->streamId);
+            glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_LOD, t->minLod - target);
+        }
+        if (t->residentBase <= t->desiredBase && t->uploadRow == 0 && t->minLod <= target){   // completa: libera o cache
+            if (t->streamId != t->id){   // fim de uma recarga: troca o objeto amostrado
+                glDeleteTextures(1, &t->id);
+                t->id = t->streamId;
+                t->retiredBytes = 0;
+            }
+            unmapFile(&t->map);
+            free(t->owned);
+            t->owned = NULL;
+            t->cache = NULL;
+            t->state = TEX_RESIDENT;
+        }
+    }
+    makeTextureRoom(0, NULL);   // orçamento pode ter diminuído
+    return pending;
+}
+
+// Esfera
+void generateSphere(float radius, int sectorCount, int stackCount, 
+                    float** vertices, unsigned int* vertexCount, 
+                    unsigned int** indices, unsigned int* indexCount){
+    *vertexCount = (sectorCount + 1) * (stackCount + 1);
+    float* sphereVertices = (float*)malloc(*vertexCount * 8 * sizeof(float));
+    float lengthInv = 1.0f / radius;
+    float sectorStep = 2.0f * (float)M_PI / sectorCount;
+    float stackStep  = (float)M_PI / stackCount;
+    int vertexIndex = 0;
+    for (int i = 0; i <= stackCount; ++i) {
+        float stackAngle = (float)M_PI / 2.0f - i * stackStep; // i=0 -> polo norte
+        float xy = radius * cosf(stackAngle);
+        float z  = radius * sinf(stackAngle);
+        for (int j = 0; j <= sectorCount; ++j) {
+            float sectorAngle = j * sectorStep;
+            float x = xy * cosf(sectorAngle);
+            float y = xy * sinf(sectorAngle);
+            // pos
+            sphereVertices[vertexIndex++] = x;
+            sphereVertices[vertexIndex++] = y;
+            sphereVertices[vertexIndex++] = z;
+            // normal
+            sphereVertices[vertexIndex++] = x * lengthInv;
+            sphereVertices[vertexIndex++] = y * lengthInv;
+            sphereVertices[vertexIndex++] = z * lengthInv;
+            // uv
+            float s = (float)j / sectorCount;
+            float t = (float)i / stackCount; // i=0 (norte) -> t=0 ; STB já está flipando a imagem
+            sphereVertices[vertexIndex++] = s;
+            sphereVertices[vertexIndex++] = t;
+        }
+    }
+    *vertices = sphereVertices;
+
+    *indexCount = stackCount * sectorCount * 6;
+    unsigned int* sphereIndices = (unsigned int*)malloc(*indexCount * sizeof(unsigned int));
+    int index = 0;
+    for (int i = 0; i < stackCount; ++i) {
+        int k1 = i * (sectorCount + 1);
+        int k2 = k1 + sectorCount + 1;
+        for (int j = 0; j < sectorCount; ++j, ++k1, ++k2) {
+            if (i != 0) {
+                sphereIndices[index++] = k1; 
+                sphereIndices[index++] = k2; 
+                sphereIndices[index++] = k1 + 1;
+            }
+            if (i != (stackCount - 1)) {
+                sphereIndices[index++] = k1 + 1; 
+                sphereIndices[index++] = k2; 
+                sphereIndices[index++] = k2 + 1;
+            }
+        }
+    }
+    *indices = sphereIndices;
+}
+
+// Anel (malha em XZ, normal em +Y)
+void generateRing(float innerR, float outerR, int segments,
+                  float** vertices, unsigned int* vertexCount,
+                  unsigned int** indices, unsigned int* indexCount){
+    if (segments < 3) segments = 3;
+    int rings = 2;
+    *vertexCount = (unsigned int)(segments * rings);
+    float* ringVerts = (float*)malloc((*vertexCount) * 8 * sizeof(float));
+
+    int vid = 0;
+    for (int i = 0; i < segments; ++i){
+        float a = (float)i / (float)segments * 2.0f * (float)M_PI;
+        float ca = cosf(a), sa = sinf(a);
+
+        // outer
+        float xo = outerR * ca;
+        float zo = outerR * sa;
+        ringVerts[vid++] = xo; ringVerts[vid++] = 0.0f; ringVerts[vid++] = zo;
+        ringVerts[vid++] = 0.0f; ringVerts[vid++] = 1.0f; ringVerts[vid++] = 0.0f;
+        ringVerts[vid++] = 1.0f; ringVerts[vid++] = (float)i/(float)segments;
+
+        // inner
+        float xi = innerR * ca;
+        float zi = innerR * sa;
+        ringVerts[vid++] = xi; ringVerts[vid++] = 0.0f; ringVerts[vid++] = zi;
+        ringVerts[vid++] = 0.0f; ringVerts[vid++] = 1.0f; ringVerts[vid++] = 0.0f;
+        ringVerts[vid++] = 0.0f; ringVerts[vid++] = (float)i/(float)segments;
+    }
+    *vertices = ringVerts;
+
+    *indexCount = (unsigned int)(segments * 6);
+    unsigned int* ringIndices = (unsigned int*)malloc((*indexCount) * sizeof(unsigned int));
+    int iid = 0;
+    for (int i = 0; i < segments; ++i){
+        unsigned int outer_i = (unsigned int)(i * 2);
+        unsigned int inner_i = outer_i + 1;
+        unsigned int outer_n = (unsigned int)(((i + 1) % segments) * 2);
+        unsigned int inner_n = outer_n + 1;
+
+        ringIndices[iid++] = outer_i; ringIndices[iid++] = inner_i; ringIndices[iid++] = outer_n;
+        ringIndices[iid++] = inner_i; ringIndices[iid++] = inner_n; ringIndices[iid++] = outer_n;
+    }
+    *indices = ringIndices;
+}
+
+// --- Texturas procedurais (fBm de Perlin em lote) ---
+// O ruído é o mesmo de glm_perlin_vec3 (Perlin clássico do webgl-noise), mas
+// avaliado em lote: cada registrador SSE2 leva 4 pixels vizinhos da linha, então
+// as 8 quinas, os gradientes e as interpolações andam 4 pontos por instrução. As
+// linhas do mapa são divididas entre os workers com parallelFor.
+#define PROC_OCTAVES    5
+#define PROC_ROWS_GRAIN 8
+#define PROC_MAX_WIDTH  8192
+
+static int procScalarNoise;   // 1 = glm_perlin_vec3 ponto a ponto (referência do --bench-noise)
+
+#ifdef USE_SSE2
+static inline __m128 floor4(__m128 x){
+    __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(x));
+    return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, x), _mm_set1_ps(1.0f)));
+}
+
+static inline __m128 fract4(__m128 x){   // como glm_vec4_fract: nunca chega a 1
+    return _mm_min_ps(_mm_sub_ps(x, floor4(x)), _mm_set1_ps(0.999999940395355224609375f));
+}
+
+static inline __m128 permute4(__m128 x){   // mod289((x * 34 + 1) * x)
+    __m128 v = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(34.0f)), _mm_set1_ps(1.0f)), x);
+    return _mm_sub_ps(v, _mm_mul_ps(floor4(_mm_mul_ps(v, _mm_set1_ps(1.0f / 289.0f))), _mm_set1_ps(289.0f)));
+}
+
+static inline __m128 fmod4(__m128 x, __m128 period){   // fmodf: sinal do dividendo
+    __m128 q = _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_div_ps(x, period)));
+    return _mm_sub_ps(x, _mm_mul_ps(q, period));
+}
+
+// Gradiente da quina com hash h (i2gxyz + gradNorm) escalar o deslocamento (ox, oy, oz).
+static inline __m128 gradDot4(__m128 h, __m128 ox, __m128 oy, __m128 oz){
+    const __m128 half = _mm_set1_ps(0.5f), absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    __m128 gx = _mm_mul_ps(h, _mm_set1_ps(1.0f / 7.0f));
+    __m128 gy = _mm_sub_ps(fract4(_mm_mul_ps(floor4(gx), _mm_set1_ps(1.0f / 7.0f))), half);
+    gx = fract4(gx);
+    __m128 gz = _mm_sub_ps(_mm_sub_ps(half, _mm_and_ps(gx, absMask)), _mm_and_ps(gy, absMask));
+    __m128 sz = _mm_cmple_ps(gz, _mm_setzero_ps());
+    // gx -= sz * (step(0, gx) - 0.5): gx (fract) nunca é negativo
+    gx = _mm_sub_ps(gx, _mm_and_ps(sz, half));
+    __m128 sy = _mm_sub_ps(_mm_and_ps(_mm_cmpge_ps(gy, _mm_setzero_ps()), _mm_set1_ps(1.0f)), half);
+    gy = _mm_sub_ps(gy, _mm_and_ps(sz, sy));
+    __m128 len2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(gx, gx), _mm_mul_ps(gy, gy)), _mm_mul_ps(gz, gz));
+    __m128 norm = _mm_sub_ps(_mm_set1_ps(1.79284291400159f), _mm_mul_ps(_mm_set1_ps(0.85373472095314f), len2));
+    __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(gx, ox), _mm_mul_ps(gy, oy)), _mm_mul_ps(gz, oz));
+    return _mm_mul_ps(norm, d);
+}
+
+static inline __m128 fade4(__m128 t){   // t³ (t (6t - 15) + 10)
+    __m128 inner = _mm_add_ps(_mm_mul_ps(t, _mm_sub_ps(_mm_mul_ps(t, _mm_set1_ps(6.0f)), _mm_set1_ps(15.0f))), _mm_set1_ps(10.0f));
+    return _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(t, t), t), inner);
+}
+
+static inline __m128 lerp4(__m128 a, __m128 b, __m128 t){ return _mm_add_ps(a, _mm_mul_ps(t, _mm_sub_ps(b, a))); }
+
+// period = 289 reproduz glm_perlin_vec3; períodos menores repetem o ruído a cada
+// 'period' células (volumes que ladrilham).
+static __m128 perlin4(__m128 x, __m128 y, __m128 z, __m128 period){
+    const __m128 one = _mm_set1_ps(1.0f);
+    __m128 fx = floor4(x), fy = floor4(y), fz = floor4(z);
+    __m128 ix0 = fmod4(fx, period), ix1 = fmod4(_mm_add_ps(fx, one), period);
+    __m128 iy0 = fmod4(fy, period), iy1 = fmod4(_mm_add_ps(fy, one), period);
+    __m128 iz0 = fmod4(fz, period), iz1 = fmod4(_mm_add_ps(fz, one), period);
+    __m128 x0 = fract4(x), y0 = fract4(y), z0 = fract4(z);
+    __m128 x1 = _mm_sub_ps(x0, one), y1 = _mm_sub_ps(y0, one), z1 = _mm_sub_ps(z0, one);
+
+    __m128 px0 = permute4(ix0), px1 = permute4(ix1);
+    __m128 h00 = permute4(_mm_add_ps(px0, iy0)), h10 = permute4(_mm_add_ps(px1, iy0));
+    __m128 h01 = permute4(_mm_add_ps(px0, iy1)), h11 = permute4(_mm_add_ps(px1, iy1));
+
+    __m128 n000 = gradDot4(permute4(_mm_add_ps(h00, iz0)), x0, y0, z0);
+    __m128 n100 = gradDot4(permute4(_mm_add_ps(h10, iz0)), x1, y0, z0);
+    __m128 n010 = gradDot4(permute4(_mm_add_ps(h01, iz0)), x0, y1, z0);
+    __m128 n110 = gradDot4(permute4(_mm_add_ps(h11, iz0)), x1, y1, z0);
+    __m128 n001 = gradDot4(permute4(_mm_add_ps(h00, iz1)), x0, y0, z1);
+    __m128 n101 = gradDot4(permute4(_mm_add_ps(h10, iz1)), x1, y0, z1);
+    __m128 n011 = gradDot4(permute4(_mm_add_ps(h01, iz1)), x0, y1, z1);
+    __m128 n111 = gradDot4(permute4(_mm_add_ps(h11, iz1)), x1, y1, z1);
+
+    __m128 ux = fade4(x0), uy = fade4(y0), uz = fade4(z0);
+    __m128 n00 = lerp4(n000, n001, uz), n10 = lerp4(n100, n101, uz);
+    __m128 n01 = lerp4(n010, n011, uz), n11 = lerp4(n110, n111, uz);
+    __m128 n0 = lerp4(n00, n01, uy), n1 = lerp4(n10, n11, uy);
+    return _mm_mul_ps(lerp4(n0, n1, ux), _mm_set1_ps(2.2f));
+}
+#endif
+
+// Versão escalar com período (o glm_perlin_vec3 só repete a cada 289): as mesmas
+// contas do perlin4, um ponto por vez.
+static float permute1(float x){
+    float v = (x * 34.0f + 1.0f) * x;
+    return v - floorf(v * (1.0f / 289.0f)) * 289.0f;
+}
+
+static float fract1(float x){ return fminf(x - floorf(x), 0.999999940395355224609375f); }
+
+static float gradDot1(float h, float ox, float oy, float oz){
+    float gx = h * (1.0f / 7.0f);
+    float gy = fract1(floorf(gx) * (1.0f / 7.0f)) - 0.5f;
+    gx = fract1(gx);
+    float gz = 0.5f - fabsf(gx) - fabsf(gy);
+    if (gz <= 0.0f){ gx -= 0.5f; gy -= gy < 0.0f ? -0.5f : 0.5f; }
+    float norm = 1.79284291400159f - 0.85373472095314f * (gx * gx + gy * gy + gz * gz);
+    return norm * (gx * ox + gy * oy + gz * oz);
+}
+
+static float fade1(float t){ return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f); }
+
+static float perlinPeriodic(float x, float y, float z, float period){
+    float fx = floorf(x), fy = floorf(y), fz = floorf(z);
+    float ix0 = fmodf(fx, period), ix1 = fmodf(fx + 1.0f, period);
+    float iy0 = fmodf(fy, period), iy1 = fmodf(fy + 1.0f, period);
+    float iz0 = fmodf(fz, period), iz1 = fmodf(fz + 1.0f, period);
+    float x0 = fract1(x), y0 = fract1(y), z0 = fract1(z);
+    float x1 = x0 - 1.0f, y1 = y0 - 1.0f, z1 = z0 - 1.0f;
+    float px0 = permute1(ix0), px1 = permute1(ix1);
+    float h00 = permute1(px0 + iy0), h10 = permute1(px1 + iy0);
+    float h01 = permute1(px0 + iy1), h11 = permute1(px1 + iy1);
+    float uz = fade1(z0), uy = fade1(y0), ux = fade1(x0);
+    float n00 = glm_lerp(gradDot1(permute1(h00 + iz0), x0, y0, z0), gradDot1(permute1(h00 + iz1), x0, y0, z1), uz);
+    float n10 = glm_lerp(gradDot1(permute1(h10 + iz0), x1, y0, z0), gradDot1(permute1(h10 + iz1), x1, y0, z1), uz);
+    float n01 = glm_lerp(gradDot1(permute1(h01 + iz0), x0, y1, z0), gradDot1(permute1(h01 + iz1), x0, y1, z1), uz);
+    float n11 = glm_lerp(gradDot1(permute1(h11 + iz0), x1, y1, z0), gradDot1(permute1(h11 + iz1), x1, y1, z1), uz);
+    return glm_lerp(glm_lerp(n00, n01, uy), glm_lerp(n10, n11, uy), ux) * 2.2f;
+}
+
+// out[i] += amplitude * perlin(frequency * (x[i], y[i], z[i])), para i < n.
+// period: em células da grade (289 = sem repetição visível).
+static void perlinAccumulate(const float* x, const float* y, const float* z, int n,
+                             float frequency, float amplitude, float period, float* out){
+    int i = 0;
+#ifdef USE_SSE2
+    if (!procScalarNoise){
+        const __m128 f = _mm_set1_ps(frequency), a = _mm_set1_ps(amplitude), per = _mm_set1_ps(period);
+        for (; i + 4 <= n; i += 4){
+            __m128 v = perlin4(_mm_mul_ps(_mm_loadu_ps(x + i), f), _mm_mul_ps(_mm_loadu_ps(y + i), f),
+                               _mm_mul_ps(_mm_loadu_ps(z + i), f), per);
+            _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), _mm_mul_ps(v, a)));
+        }
+    }
+#endif
+    for (; i < n; ++i){
+        vec3 p = {x[i] * frequency, y[i] * frequency, z[i] * frequency};
+        out[i] += amplitude * (period == 289.0f ? glm_perlin_vec3(p) : perlinPeriodic(p[0], p[1], p[2], period));
+    }
+}
+
+// fBm: oitavas com o dobro da frequência e metade da amplitude (soma em ~[-1, 1]).
+// tile = 1: coordenadas em [0, 1) e cada oitava repete a cada 'frequency' células,
+// então o resultado ladrilha o cubo unitário.
+static void fbmRow(const float* x, const float* y, const float* z, int n,
+                   int octaves, float frequency, int tile, float* out){
+    memset(out, 0, (size_t)n * sizeof(float));
+    float amplitude = 0.5f;
+    for (int o = 0; o < octaves; ++o, frequency *= 2.0f, amplitude *= 0.5f)
+        perlinAccumulate(x, y, z, n, frequency, amplitude, tile ? frequency : 289.0f, out);
+}
+
+// Paleta de 3 cores com t em [0, 1].
+static void paletteColor(const float colors[3][3], float t, float shade, unsigned char* dst){
+    t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+    const float* a = t < 0.5f ? colors[0] : colors[1];
+    const float* b = t < 0.5f ? colors[1] : colors[2];
+    float u = t < 0.5f ? t * 2.0f : t * 2.0f - 1.0f;
+    for (int c = 0; c < 3; ++c){
+        float v = (a[c] + (b[c] - a[c]) * u) * shade;
+        dst[c] = (unsigned char)(v <= 0.0f ? 0 : (v >= 1.0f ? 255 : v * 255.0f + 0.5f));
+    }
+}
+
+typedef struct {
+    const ProceduralParams* p;
+    unsigned char* pixels;
+    int   w, h;
+    float offset[3];        // deslocamento do domínio pela semente
+    const float* cosLon;    // por coluna
+    const float* sinLon;
+} ProcJob;
+
+static void procRows(void* ctx, int begin, int end){
+    ProcJob* job = (ProcJob*)ctx;
+    const ProceduralParams* p = job->p;
+    int w = job->w;
+    float* buf = (float*)malloc((size_t)w * 5 * sizeof(float));
+    if (!buf) return;
+    float *x = buf, *y = buf + w, *z = buf + 2 * w, *a = buf + 3 * w, *b = buf + 4 * w;
+    for (int row = begin; row < end; ++row){
+        float lat = ((float)row + 0.5f) / (float)job->h * GLM_PIf - 0.5f * GLM_PIf;
+        float cl = cosf(lat), sl = sinf(lat);
+        unsigned char* dst = job->pixels + (size_t)row * w * 3;
+        if (p->kind == PROC_GAS_GIANT){
+            // turbulência esticada na longitude (faixas compridas), mais nuvens menores
+            for (int i = 0; i < w; ++i){
+                x[i] = cl * job->cosLon[i] * 3.0f + job->offset[0];
+                y[i] = sl * 12.0f + job->offset[1];
+                z[i] = cl * job->sinLon[i] * 3.0f + job->offset[2];
+            }
+            fbmRow(x, y, z, w, PROC_OCTAVES, 1.0f, 0, a);
+            for (int i = 0; i < w; ++i){
+                x[i] = cl * job->cosLon[i] + job->offset[1];
+                y[i] = sl + job->offset[2];
+                z[i] = cl * job->sinLon[i] + job->offset[0];
+            }
+            fbmRow(x, y, z, w, 3, 6.0f, 0, b);
+            for (int i = 0; i < w; ++i){
+                float band = 0.5f + 0.5f * sinf((sl * p->bands + p->turbulence * a[i]) * GLM_PIf);
+                paletteColor(p->colors, band, 1.0f + 0.2f * b[i], dst + i * 3);
+            }
+        } else {
+            // granulação fina modulada por manchas grandes e mais escuras
+            for (int i = 0; i < w; ++i){
+                x[i] = cl * job->cosLon[i] + job->offset[0];
+                y[i] = sl + job->offset[1];
+                z[i] = cl * job->sinLon[i] + job->offset[2];
+            }
+            fbmRow(x, y, z, w, PROC_OCTAVES, 24.0f, 0, a);
+            fbmRow(x, y, z, w, 3, 3.0f, 0, b);
+            for (int i = 0; i < w; ++i){
+                float spots = b[i] > 0.25f ? (b[i] - 0.25f) * 1.5f : 0.0f;
+                paletteColor(p->colors, 0.65f + 0.6f * p->turbulence * a[i] - spots, 1.0f, dst + i * 3);
+            }
+        }
+    }
+    free(buf);
+}
+
+static void procGenerate(const ProceduralParams* p, unsigned char* pixels, int w, int h, int threaded){
+    float* lon = (float*)malloc((size_t)w * 2 * sizeof(float));
+    if (!lon) return;
+    for (int i = 0; i < w; ++i){
+        float a = ((float)i + 0.5f) / (float)w * 2.0f * GLM_PIf;
+        lon[i] = cosf(a);
+        lon[w + i] = sinf(a);
+    }
+    ProcJob job = {p, pixels, w, h, {0.0f, 0.0f, 0.0f}, lon, lon + w};
+    uint64_t sh = hashBytes(&p->seed, sizeof(p->seed), HASH_SEED);
+    for (int k = 0; k < 3; ++k) job.offset[k] = (float)((sh >> (k * 16)) & 0xffff) / 65536.0f * 100.0f;
+    if (threaded) parallelFor(&workers, h, PROC_ROWS_GRAIN, procRows, &job);
+    else procRows(&job, 0, h);
+    free(lon);
+}
+
+unsigned char* generateProceduralTexture(const ProceduralParams* params, int* w, int* h){
+    int width = (int)params->width, height = width / 2;
+    fitTextureDims(&width, &height);   // gera direto no tamanho do preset
+    if (width < 16) width = 16;
+    if (width > PROC_MAX_WIDTH) width = PROC_MAX_WIDTH;
+    unsigned char* pixels = (unsigned char*)malloc((size_t)width * (width / 2) * 3);
+    if (!pixels) return NULL;
+    procGenerate(params, pixels, width, width / 2, 1);
+    *w = width;
+    *h = width / 2;
+    return pixels;
+}
+
+// O caminho sai dos parâmetros: os mesmos parâmetros dão a mesma textura (e a
+// mesma miniatura entre sessões).
+Texture* loadProceduralTexture(const ProceduralParams* params){
+    static const char* kindNames[] = {"gigante", "estrela"};
+    char path[64];
+    snprintf(path, sizeof(path), "proc:%s/%016llx", kindNames[params->kind == PROC_STAR],
+             (unsigned long long)hashBytes(params, sizeof(*params), HASH_SEED));
+    Texture* tex = loadTexture2D(path);
+    if (!tex->procedural){
+        tex->procedural = (ProceduralParams*)malloc(sizeof(ProceduralParams));
+        memcpy(tex->procedural, params, sizeof(ProceduralParams));
+    }
+    return tex;
+}
+
+// --- Céu (cubemap convertido do mapa equirretangular) ---
+// A conversão roda num worker e o resultado fica em cache/texturas/<hash>.sky:
+// cabeçalho + 6 faces (+X -X +Y -Y +Z -Z) na ordem de GL_TEXTURE_CUBE_MAP_POSITIVE_X.
+// O mapeamento reproduz a antiga esfera do céu (rotX(-90°), UV da generateSphere,
+// imagem já invertida pelo stb), então o céu aparece na mesma orientação.
+#define SKYCACHE_MAGIC   0x31594b53u   // "SKY1"
+#define SKYCACHE_VERSION 1u
+#define SKY_SUPERSAMPLE  2             // amostras por eixo em cada texel da face
+
+typedef struct {
+    uint32_t magic, version;
+    uint64_t sourceHash;
+    uint32_t faceSize, channels;
+    uint32_t reserved[2];              // faces começam alinhadas em 16 bytes
+} SkyCacheHeader;
+
+typedef struct {
+    const unsigned char* src;
+    int w, h, n, faceSize;
+    unsigned char* faces;
+} SkyJob;
+
+// Direção do texel (a, b em [-1, 1]) de cada face, pela tabela do GL.
+static void cubeFaceDir(int face, float a, float b, vec3 d){
+    switch (face){
+    case 0:  d[0] =  1.0f; d[1] = -b;    d[2] = -a;    break;
+    case 1:  d[0] = -1.0f; d[1] = -b;    d[2] =  a;    break;
+    case 2:  d[0] =  a;    d[1] =  1.0f; d[2] =  b;    break;
+    case 3:  d[0] =  a;    d[1] = -1.0f; d[2] = -b;    break;
+    case 4:  d[0] =  a;    d[1] = -b;    d[2] =  1.0f; break;
+    default: d[0] = -a;    d[1] = -b;    d[2] = -1.0f; break;
+    }
+    glm_vec3_normalize(d);
+}
+
+// Amostra bilinear do equirretangular na direção d (s repete, t prende nos polos).
+static void sampleEquirect(const SkyJob* j, const vec3 d, float* out){
+    float lx = d[0], ly = -d[2], lz = d[1];   // desfaz a rotX(-90°) da esfera antiga
+    float s = atan2f(ly, lx) / (2.0f * GLM_PIf);
+    if (s < 0.0f) s += 1.0f;
+    float t = acosf(glm_clamp(lz, -1.0f, 1.0f)) / GLM_PIf;
+    float fx = s * j->w - 0.5f, fy = t * j->h - 0.5f;
+    int x0 = (int)floorf(fx), y0 = (int)floorf(fy);
+    float tx = fx - x0, ty = fy - y0;
+    int x1 = x0 + 1, y1 = y0 + 1;
+    x0 = (x0 % j->w + j->w) % j->w; x1 = x1 % j->w;
+    y0 = y0 < 0 ? 0 : y0; y1 = y1 >= j->h ? j->h - 1 : y1;
+    const unsigned char* p00 = j->src + ((size_t)y0 * j->w + x0) * j->n;
+    const unsigned char* p10 = j->src + ((size_t)y0 * j->w + x1) * j->n;
+    const unsigned char* p01 = j->src + ((size_t)y1 * j->w + x0) * j->n;
+    const unsigned char* p11 = j->src + ((size_t)y1 * j->w + x1) * j->n;
+    for (int c = 0; c < j->n; ++c){
+        float top = p00[c] + (p10[c] - p00[c]) * tx;
+        float bot = p01[c] + (p11[c] - p01[c]) * tx;
+        out[c] += top + (bot - top) * ty;
+    }
+}
+
+static void skyFaceRows(void* arg, int begin, int end){
+    const SkyJob* j = (const SkyJob*)arg;
+    int N = j->faceSize;
+    const float inv = 1.0f / (SKY_SUPERSAMPLE * SKY_SUPERSAMPLE);
+    for (int row = begin; row < end; ++row){   // linhas das 6 faces em sequência
+        int face = row / N, y = row % N;
+        unsigned char* dst = j->faces + (size_t)row * N * j->n;
+        for (int x = 0; x < N; ++x){
+            float acc[4] = {0, 0, 0, 0};
+            for (int sy = 0; sy < SKY_SUPERSAMPLE; ++sy){
+                for (int sx = 0; sx < SKY_SUPERSAMPLE; ++sx){
+                    float a = 2.0f * (x + (sx + 0.5f) / SKY_SUPERSAMPLE) / N - 1.0f;
+                    float b = 2.0f * (y + (sy + 0.5f) / SKY_SUPERSAMPLE) / N - 1.0f;
+                    vec3 d;
+                    cubeFaceDir(face, a, b, d);
+                    sampleEquirect(j, d, acc);
+                }
+            }
+            for (int c = 0; c < j->n; ++c) dst[x * j->n + c] = (unsigned char)(acc[c] * inv + 0.5f);
+        }
+    }
+}
+
+static unsigned char* buildSkyCache(const unsigned char* pixels, int w, int h, int n, uint64_t hash, size_t* outSize){
+    SkyCacheHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = SKYCACHE_MAGIC;
+    hdr.version = SKYCACHE_VERSION;
+    hdr.sourceHash = hash;
+    int faceSize = w / 4 > 1 ? w / 4 : 1, faceRows = faceSize;   // 90° da face = 1/4 da volta
+    fitTextureDims(&faceSize, &faceRows);
+    hdr.faceSize = (uint32_t)faceSize;
+    hdr.channels = (uint32_t)n;
+    size_t faceBytes = (size_t)hdr.faceSize * hdr.faceSize * n;
+    unsigned char* blob = (unsigned char*)malloc(sizeof(hdr) + 6 * faceBytes);
+    if (!blob) return NULL;
+    memcpy(blob, &hdr, sizeof(hdr));
+    SkyJob job = {pixels, w, h, n, (int)hdr.faceSize, blob + sizeof(hdr)};
+    parallelFor(&workers, 6 * job.faceSize, 16, skyFaceRows, &job);
+    *outSize = sizeof(hdr) + 6 * faceBytes;
+    return blob;
+}
+
+static int validSkyCache(const unsigned char* data, size_t size, uint64_t sourceHash){
+    if (size < sizeof(SkyCacheHeader)) return 0;
+    const SkyCacheHeader* hdr = (const SkyCacheHeader*)data;
+    if (hdr->magic != SKYCACHE_MAGIC || hdr->version != SKYCACHE_VERSION) return 0;
+    if (hdr->sourceHash != sourceHash || hdr->channels < 1 || hdr->channels > 4) return 0;
+    return size >= sizeof(SkyCacheHeader) + 6 * (size_t)hdr->faceSize * hdr->faceSize * hdr->channels;
+}
+
+static void convertSkyboxJob(void* arg){
+    Skybox* sky = (Skybox*)arg;
+    AssetView src;
+    if (openAsset(sky->path, &src)){
+        const uint32_t keyInfo[2] = {SKYCACHE_VERSION, (uint32_t)quality->maxTextureSize};
+        uint64_t hash = hashBytes(src.data, src.size, hashBytes(keyInfo, sizeof(keyInfo), HASH_SEED));
+        char cachePath[300];
+        snprintf(cachePath, sizeof(cachePath), TEXCACHE_DIR "/%016llx.sky", (unsigned long long)hash);
+
+        if (mapFile(cachePath, &sky->map) && validSkyCache(sky->map.data, sky->map.size, hash)){
+            sky->cache = sky->map.data;
+        } else {
+            unmapFile(&sky->map);
+            int w, h, n;
+            decodeArenaBegin();
+            unsigned char* pixels = decodeImage(src.data, src.size, &w, &h, &n);
+            size_t size = 0;
+            if (pixels) sky->owned = buildSkyCache(pixels, w, h, n, hash, &size);
+            stbi_image_free(pixels);
+            decodeArenaEnd();
+            if (sky->owned){
+                sky->cache = sky->owned;
+                makeDirs(TEXCACHE_DIR);
+                if (!writeFileAtomic(cachePath, sky->owned, size))
+                    printf("Aviso: nao foi possivel gravar o cache %s\n", cachePath);
+            }
+        }
+        closeAsset(&src);
+    }
+    mutexLock(&sky->lock);
+    sky->done = 1;
+    mutexUnlock(&sky->lock);
+}
+
+Skybox* loadSkybox(const char* equirectPath){
+    Skybox* sky = (Skybox*)calloc(1, sizeof(Skybox));
+    snprintf(sky->path, sizeof(sky->path), "%s", equirectPath);
+    mutexInit(&sky->lock);
+    jobPoolSubmit(&workers, convertSkyboxJob, sky);
+    return sky;
+}
+
+// Envia as faces quando a conversão termina; até lá (ou se falhar) retorna 0.
+int skyboxReady(Skybox* sky){
+    if (sky->id) return 1;
+    if (sky->failed) return 0;
+    mutexLock(&sky->lock);
+    int done = sky->done;
+    mutexUnlock(&sky->lock);
+    if (!done) return 0;
+    if (!sky->cache){
+        printf("Falha ao carregar textura: %s\n", sky->path);
+        sky->failed = 1;
+        return 0;
+    }
+    static const GLenum formats[] = {0, GL_RED, GL_RG, GL_RGB, GL_RGBA};
+    const SkyCacheHeader* hdr = (const SkyCacheHeader*)sky->cache;
+    GLsizei N = (GLsizei)hdr->faceSize;
+    GLenum fmt = formats[hdr->channels];
+    size_t faceBytes = (size_t)N * N * hdr->channels;
+    glGenTextures(1, &sky->id);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, sky->id);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (int f = 0; f < 6; ++f)
+        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + f, 0, (GLint)fmt, N, N, 0, fmt, GL_UNSIGNED_BYTE,
+                     sky->cache + sizeof(SkyCacheHeader) + f * faceBytes);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    unmapFile(&sky->map);
+    free(sky->owned);
+    sky->owned = NULL;
+    sky->cache = NULL;
+    return 1;
+}
+
+// --- Volume de ruído 3D ---
+// fBm periódico amostrado num cubo de size³ voxels; cada oitava repete um número
+// inteiro de vezes dentro do cubo, então GL_REPEAT não mostra emendas. Gerado
+// nos workers (linhas de voxels em lote pelo perlin4) e guardado em
+// cache/texturas/<hash>.n3d, chaveado pelos parâmetros.
+#define NOISECACHE_MAGIC   0x44334e53u   // "SN3D"
+#define NOISECACHE_VERSION 1u
+#define NOISE_BASE_CELLS   4             // células da oitava mais grossa por eixo
+#define NOISE_OCTAVES      4
+
+typedef struct {
+    uint32_t magic, version;
+    uint64_t paramsHash;
+    uint32_t size, reserved;
+} NoiseCacheHeader;
+
+typedef struct {
+    int size;
+    unsigned char* voxels;
+} NoiseJob;
+
+static void noiseVolumeRows(void* ctx, int begin, int end){
+    const NoiseJob* job = (const NoiseJob*)ctx;
+    int n = job->size;
+    float* buf = (float*)malloc((size_t)n * 4 * sizeof(float));
+    if (!buf) return;
+    float *x = buf, *y = buf + n, *z = buf + 2 * n, *v = buf + 3 * n;
+    for (int i = 0; i < n; ++i) x[i] = (float)i / (float)n;
+    for (int row = begin; row < end; ++row){   // row = z * size + y
+        float fy = (float)(row % n) / (float)n, fz = (float)(row / n) / (float)n;
+        for (int i = 0; i < n; ++i){ y[i] = fy; z[i] = fz; }
+        fbmRow(x, y, z, n, NOISE_OCTAVES, (float)NOISE_BASE_CELLS, 1, v);
+        unsigned char* dst = job->voxels + (size_t)row * n;
+        for (int i = 0; i < n; ++i){
+            float t = v[i] * 0.5f + 0.5f;   // fBm em ~[-1, 1]
+            dst[i] = (unsigned char)(t <= 0.0f ? 0 : (t >= 1.0f ? 255 : t * 255.0f + 0.5f));
+        }
+    }
+    free(buf);
+}
+
+static uint64_t noiseVolumeHash(int size){
+    const uint32_t keyInfo[4] = {NOISECACHE_VERSION, (uint32_t)size, NOISE_BASE_CELLS, NOISE_OCTAVES};
+    return hashBytes(keyInfo, sizeof(keyInfo), HASH_SEED);
+}
+
+static int validNoiseCache(const unsigned char* data, size_t size, uint64_t hash, int n){
+    if (size < sizeof(NoiseCacheHeader)) return 0;
+    const NoiseCacheHeader* hdr = (const NoiseCacheHeader*)data;
+    return hdr->magic == NOISECACHE_MAGIC && hdr->version == NOISECACHE_VERSION && hdr->paramsHash == hash
+        && hdr->size == (uint32_t)n && size >= sizeof(NoiseCacheHeader) + (size_t)n * n * n;
+}
+
+static void buildNoiseVolumeJob(void* arg){
+    NoiseVolume* vol = (NoiseVolume*)arg;
+    int n = vol->size;
+    uint64_t hash = noiseVolumeHash(n);
+    char cachePath[300];
+    snprintf(cachePath, sizeof(cachePath), TEXCACHE_DIR "/%016llx.n3d", (unsigned long long)hash);
+
+    if (mapFile(cachePath, &vol->map) && validNoiseCache(vol->map.data, vol->map.size, hash, n)){
+        vol->cache = vol->map.data;
+    } else {
+        unmapFile(&vol->map);
+        size_t size = sizeof(NoiseCacheHeader) + (size_t)n * n * n;
+        vol->owned = (unsigned char*)malloc(size);
+        if (vol->owned){
+            NoiseCacheHeader hdr = {NOISECACHE_MAGIC, NOISECACHE_VERSION, hash, (uint32_t)n, 0};
+            memcpy(vol->owned, &hdr, sizeof(hdr));
+            NoiseJob job = {n, vol->owned + sizeof(hdr)};
+            double t0 = nowSeconds();
+            parallelFor(&workers, n * n, 16, noiseVolumeRows, &job);
+            printf("Volume de ruido %d^3 gerado em %.1f ms\n", n, (nowSeconds() - t0) * 1000.0);
+            vol->cache = vol->owned;
+            makeDirs(TEXCACHE_DIR);
+            if (!writeFileAtomic(cachePath, vol->owned, size))
+                printf("Aviso: nao foi possivel gravar o cache %s\n", cachePath);
+        }
+    }
+    mutexLock(&vol->lock);
+    vol->done = 1;
+    mutexUnlock(&vol->lock);
+}
+
+NoiseVolume* loadNoiseVolume(int size){
+    NoiseVolume* vol = (NoiseVolume*)calloc(1, sizeof(NoiseVolume));
+    vol->size = size;
+    mutexInit(&vol->lock);
+    jobPoolSubmit(&workers, buildNoiseVolumeJob, vol);
+    return vol;
+}
+
+// Envia o volume quando o worker termina; até lá (ou se falhar) retorna 0.
+int noiseVolumeReady(NoiseVolume* vol){
+    if (vol->id) return 1;
+    if (vol->failed) return 0;
+    mutexLock(&vol->lock);
+    int done = vol->done;
+    mutexUnlock(&vol->lock);
+    if (!done) return 0;
+    if (!vol->cache){
+        printf("Falha ao gerar o volume de ruido\n");
+        vol->failed = 1;
+        return 0;
+    }
+    glGenTextures(1, &vol->id);
+    glBindTexture(GL_TEXTURE_3D, vol->id);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_R8, vol->size, vol->size, vol->size, 0, GL_RED, GL_UNSIGNED_BYTE,
+                 vol->cache + sizeof(NoiseCacheHeader));
+    glGenerateMipmap(GL_TEXTURE_3D);   // o Sol ao longe não cintila
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_REPEAT);
+    unmapFile(&vol->map);
+    free(vol->owned);
+    vol->owned = NULL;
+    vol->cache = NULL;
+    return 1;
+}
+
+// --- Texturas virtuais (page file + page table + cache físico) ---
+// Mapas grandes demais para loadTexture2D (ex.: Terra em 32K) viram um page file em
+// cache/texturas/<hash>.vt: a cadeia de mips (mesmo filtro do cache de texturas),
+// montada em faixas direto da fonte e cortada em tiles de VT_TILE texels com
+// VT_BORDER de borda, RGBA8. Na GPU ficam só:
+//  - o cache físico, uma textura fixa de VT_PHYS_SLOTS x VT_PHYS_SLOTS páginas,
+//    compartilhada por todas as texturas virtuais;
+//  - uma page table por textura (um texel por tile, com mips) que aponta para a
+//    página do tile ou, se ele não está residente, do ancestral mais fino que está.
+// Os objetos com textura virtual são redesenhados num passe de feedback em
+// 1/VT_FEEDBACK_DIV da resolução, que grava o tile pedido por pixel. O resultado
+// volta por PBO (com fence, sem travar) para a thread do VT, que junta os pedidos,
+// marca o uso e lê do page file os tiles que faltam para buffers de staging fixos,
+// num lote só de E/S assíncrona (O_DIRECT: cada tile ocupa VT_TILE_STRIDE alinhado).
+// O quadro seguinte envia até VT_UPLOADS_PER_FRAME tiles, reaproveitando as páginas
+// usadas há mais tempo, e refaz as page tables. O nível mais grosso nunca sai.
+// A memória não depende do tamanho da fonte (só a page table cresce: 4 bytes/tile).
+#define VT_MAGIC             0x31585456u   // "VTX1"
+#define VT_VERSION           3u
+#define VT_TILE              128
+#define VT_BORDER            4
+#define VT_PAGE              (VT_TILE + 2 * VT_BORDER)
+#define VT_PAGE_BYTES        ((size_t)VT_PAGE * VT_PAGE * 4)
+#define VT_TILE_STRIDE       ((VT_PAGE_BYTES + IO_ALIGN - 1) & ~(size_t)(IO_ALIGN - 1))   // página + preenchimento
+#define VT_PHYS_SLOTS        16            // 16x16 páginas: 2176² RGBA8 (~18 MB)
+#define VT_MAX_TEXTURES      8
+#define VT_MAX_TILES_AXIS    1024          // 10 bits por eixo no feedback (até 128K texels)
+#define VT_STAGING_TILES     32
+#define VT_UPLOADS_PER_FRAME 8
+#define VT_FEEDBACK_DIV      8
+#define VT_FEEDBACK_DRAWS    32
+#define VT_READBACK_RING     2
+#define VT_DATA_ALIGN        4096u
+#define VT_BUILD_ROWS        32            // linhas por lote na montagem do page file
+
+typedef struct {
+    uint32_t magic, version;
+    uint64_t sourceHash;
+    uint32_t width, height, levelCount, reserved;
+    uint32_t tilesX[TEXTURE_MAX_LEVELS], tilesY[TEXTURE_MAX_LEVELS], firstTile[TEXTURE_MAX_LEVELS];
+    uint64_t dataOffset;                 // início dos tiles (alinhado em VT_DATA_ALIGN)
+} VTHeader;
+
+enum { TILE_ABSENT, TILE_LOADING, TILE_READY, TILE_RESIDENT };
+
+struct VirtualTexture {
+    int   id;                            // posição em vtList (+1 no feedback)
+    char  path[256];
+    IoFile file;                         // page file (só a thread do VT lê; válido se opened)
+    VTHeader hdr;
+    int   opened, failed;
+    // Estado por tile; índice = hdr.firstTile[nível] + y * hdr.tilesX[nível] + x
+    uint32_t       tileCount;
+    unsigned char* state;
+    unsigned*      lastUsed;             // quadro do último feedback que pediu o tile
+    short*         slot;                 // página física (-1 = nenhuma)
+    // Thread principal
+    GLuint         pageTable;
+    unsigned char* entries;              // espelho RGBA da page table, mesmo índice dos tiles
+    int            dirty;
+};
+
+typedef struct { VirtualTexture* vt; uint32_t tile; int level; } VTRequest;
+typedef struct { VirtualTexture* vt; uint32_t tile; int staging; } VTReady;
+typedef struct { VirtualTexture* vt; uint32_t tile; } VTSlot;
+typedef struct { VirtualTexture* vt; mat4 model; const Mesh* mesh; int lod; } VTDraw;
+
+static int             vtStarted;
+static Thread          vtThread;
+static Mutex           vtLock;
+static Cond            vtWake;
+static int             vtQuit, vtKick;
+static VirtualTexture* vtList[VT_MAX_TEXTURES];
+static int             vtCount;
+// Feedback entregue à thread (protegido por vtLock)
+static unsigned char*  vtFeedback;
+static size_t          vtFeedbackCap, vtFeedbackPixels;
+static unsigned        vtFeedbackFrame, vtLastFeedbackFrame;
+static int             vtFeedbackPending;
+// Staging: buffers fixos preenchidos pela thread e consumidos pelo upload
+static unsigned char*  vtStaging[VT_STAGING_TILES];
+static int             vtStagingFree[VT_STAGING_TILES], vtStagingFreeCount;
+static VTReady         vtReady[VT_STAGING_TILES];
+static int             vtReadyCount;
+static IoQueue         vtIoDone;         // leituras de tiles concluídas
+// GL (só a thread principal)
+static ShaderProgram*  vtProgram;
+static ShaderProgram*  vtFeedbackProgram;
+static GLuint          vtPhysTex;
+static GLuint          vtFbo, vtFbColor, vtFbDepth;
+static int             vtFbW, vtFbH;
+static GLuint          vtReadPBO[VT_READBACK_RING];
+static GLsync          vtReadFence[VT_READBACK_RING];
+static size_t          vtReadCap[VT_READBACK_RING], vtReadPixels[VT_READBACK_RING];
+static unsigned        vtReadFrame[VT_READBACK_RING];
+static int             vtReadNext;
+static VTSlot          vtSlots[VT_PHYS_SLOTS * VT_PHYS_SLOTS];
+static VTDraw          vtDraws[VT_FEEDBACK_DRAWS];
+static int             vtDrawCount;
+static unsigned        vtFrame;
+
+static int isPow2(uint32_t v){ return v && !(v & (v - 1)); }
+
+// Um nível durante a montagem do page file. As linhas chegam em lotes, de cima
+// para baixo; a faixa guarda só as VT_PAGE mais recentes, o bastante para uma linha
+// de tiles com as bordas. Havendo nível seguinte, o lote também passa pelo filtro
+// horizontal dos mips para um anel, e cada linha do nível seguinte sai do filtro
+// vertical assim que todas as suas linhas-fonte chegaram.
+typedef struct {
+    int w, h;
+    int rows, tileRow;           // linhas recebidas; próxima linha de tiles a gravar
+    unsigned char* band;         // anel de VT_PAGE linhas (n bytes/pixel)
+    float* linear;               // lote em RGBA linear (entrada do filtro)
+    unsigned char* bytes;        // lote em 8 bits (níveis > 0; o 0 vem da fonte)
+    FilterTable fx, fy;          // redução para o nível seguinte
+    float* tmp;                  // anel após o passe horizontal
+    int ring, nextOut;           // linhas no anel; próxima linha do nível seguinte
+} VTLevelBuild;
+
+typedef struct {
+    FILE* f;
+    const VTHeader* hdr;
+    int n, flipped;
+    unsigned char* page;
+    VTLevelBuild levels[TEXTURE_MAX_LEVELS];
+} VTBuild;
+
+// Corta a linha de tiles pronta em páginas RGBA com borda (repete em s, que dá a
+// volta no planeta; prende em t) e grava cada uma no seu lugar, ocupando
+// VT_TILE_STRIDE bytes. Com a fonte invertida (flip do stb) as linhas chegam na
+// ordem do arquivo: a página vai de cabeça para baixo na linha de tiles espelhada.
+static int writeTileRow(VTBuild* b, int level){
+    const VTHeader* hdr = b->hdr;
+    VTLevelBuild* lv = &b->levels[level];
+    int w = lv->w, h = lv->h, n = b->n, ty = lv->tileRow;
+    uint32_t row = b->flipped ? hdr->tilesY[level] - 1 - (uint32_t)ty : (uint32_t)ty;
+    for (int tx = 0; tx < w / VT_TILE; ++tx){
+        for (int py = 0; py < VT_PAGE; ++py){
+            int sy = ty * VT_TILE + py - VT_BORDER;
+            sy = sy < 0 ? 0 : (sy >= h ? h - 1 : sy);
+            const unsigned char* src = lv->band + (size_t)(sy % VT_PAGE) * w * n;
+            unsigned char* d = b->page + (size_t)(b->flipped ? VT_PAGE - 1 - py : py) * VT_PAGE * 4;
+            for (int px = 0; px < VT_PAGE; ++px, d += 4){
+                int sx = ((tx * VT_TILE + px - VT_BORDER) % w + w) % w;
+                const unsigned char* s = src + (size_t)sx * n;
+                d[0] = s[0];
+                d[1] = n >= 3 ? s[1] : s[0];
+                d[2] = n >= 3 ? s[2] : s[0];
+                d[3] = (n == 2 || n == 4) ? s[n - 1] : 255;
+            }
+        }
+        uint64_t tile = hdr->firstTile[level] + (uint64_t)row * hdr->tilesX[level] + (uint64_t)tx;
+        if (!writeFileAt(b->f, hdr->dataOffset + tile * VT_TILE_STRIDE, b->page, VT_TILE_STRIDE)) return 0;
+    }
+    lv->tileRow++;
+    return 1;
+}
+
+// Entrega 'count' linhas (até VT_BUILD_ROWS) ao nível: grava as linhas de tiles que
+// ficaram completas e repassa ao nível seguinte as linhas dele já calculáveis.
+// 'linear' é NULL no nível 0 (a conversão sai dos bytes).
+static int feedPageLevel(VTBuild* b, int level, const unsigned char* bytes, float* linear, int count){
+    VTLevelBuild* lv = &b->levels[level];
+    size_t stride = (size_t)lv->w * b->n;
+    int first = lv->rows;
+    for (int i = 0; i < count; ++i){
+        memcpy(lv->band + (size_t)(lv->rows % VT_PAGE) * stride, bytes + (size_t)i * stride, stride);
+        int last = lv->tileRow * VT_TILE + VT_TILE + VT_BORDER - 1;   // a borda de baixo da linha de tiles
+        if (last > lv->h - 1) last = lv->h - 1;
+        if (lv->rows++ == last && !writeTileRow(b, level)) return 0;
+    }
+    if (level + 1 == (int)b->hdr->levelCount) return 1;
+
+    VTLevelBuild* next = &b->levels[level + 1];
+    MipJob job;
+    memset(&job, 0, sizeof(job));
+    job.n = b->n;
+    job.sw = lv->w; job.sh = lv->h; job.dw = next->w; job.dh = next->h;
+    job.fx = &lv->fx; job.fy = &lv->fy;
+    job.alphaScale = 1.0f;
+    if (!linear){
+        job.bytes = bytes;
+        job.src = lv->linear;
+        parallelFor(&workers, count, 4, mipToLinearRows, &job);
+        linear = lv->linear;
+    }
+    job.src = linear;
+    job.tmp = lv->tmp; job.tmpRing = lv->ring; job.tmpBase = first;
+    parallelFor(&workers, count, 4, mipHorizontalRows, &job);
+
+    // O anel cobre o lote mais os taps do filtro, então tudo que ficou calculável
+    // sai agora, antes que o próximo lote sobrescreva as linhas mais antigas.
+    const FilterTable* fy = &lv->fy;
+    for (;;){
+        int ready = 0;
+        while (ready < VT_BUILD_ROWS && lv->nextOut + ready < next->h
+               && fy->index[(lv->nextOut + ready + 1) * fy->taps - 1] < lv->rows) ready++;
+        if (ready == 0) return 1;
+        job.dst = next->linear; job.dstBase = lv->nextOut;
+        job.out = next->bytes;
+        parallelFor(&workers, ready, 4, mipVerticalRows, &job);
+        parallelFor(&workers, ready, 8, mipToBytesRows, &job);
+        lv->nextOut += ready;
+        if (!feedPageLevel(b, level + 1, next->bytes, next->linear, ready)) return 0;
+    }
+}
+
+// Monta o page file a partir da fonte em faixas, todos os níveis ao mesmo tempo:
+// além da fonte, o pico de memória é de algumas linhas de tiles por nível
+// (proporcional à largura, não à área). A fonte só ocupa a imagem inteira quando
+// não há leitura incremental (sem libjpeg ou fora de JPEG). Os mips usam o filtro
+// e o espaço linear do cache de texturas, sem a correção de cobertura do alfa, que
+// precisaria do nível inteiro.
+static int buildPageFile(const char* pagePath, ScanlineSource* src, uint64_t hash){
+    int w = src->w, h = src->h, n = src->n;
+    if (!isPow2((uint32_t)w) || !isPow2((uint32_t)h) || w < VT_TILE || h < VT_TILE
+        || w / VT_TILE > VT_MAX_TILES_AXIS || h / VT_TILE > VT_MAX_TILES_AXIS){
+        printf("Textura virtual precisa de lados potencia de 2 entre %d e %d: %dx%d\n",
+               VT_TILE, VT_TILE * VT_MAX_TILES_AXIS, w, h);
+        return 0;
+    }
+
+    VTHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = VT_MAGIC;
+    hdr.version = VT_VERSION;
+    hdr.sourceHash = hash;
+    hdr.width = (uint32_t)w;
+    hdr.height = (uint32_t)h;
+    uint32_t tiles = 0;
+    for (uint32_t i = 0; i < TEXTURE_MAX_LEVELS && (w >> i) >= VT_TILE && (h >> i) >= VT_TILE; ++i){
+        hdr.tilesX[i] = (uint32_t)(w >> i) / VT_TILE;
+        hdr.tilesY[i] = (uint32_t)(h >> i) / VT_TILE;
+        hdr.firstTile[i] = tiles;
+        tiles += hdr.tilesX[i] * hdr.tilesY[i];
+        hdr.levelCount = i + 1;
+    }
+    hdr.dataOffset = (sizeof(hdr) + VT_DATA_ALIGN - 1) & ~(uint64_t)(VT_DATA_ALIGN - 1);
+
+    VTBuild b;
+    memset(&b, 0, sizeof(b));
+    b.hdr = &hdr;
+    b.n = n;
+    b.flipped = src->flipped;
+    b.page = (unsigned char*)calloc(1, VT_TILE_STRIDE);   // preenchimento fica zerado
+    int ok = b.page != NULL;
+    for (uint32_t i = 0; ok && i < hdr.levelCount; ++i){
+        VTLevelBuild* lv = &b.levels[i];
+        lv->w = w >> i;
+        lv->h = h >> i;
+        lv->band   = (unsigned char*)malloc((size_t)VT_PAGE * lv->w * n);
+        lv->linear = (float*)malloc((size_t)VT_BUILD_ROWS * lv->w * 4 * sizeof(float));
+        lv->bytes  = i > 0 ? (unsigned char*)malloc((size_t)VT_BUILD_ROWS * lv->w * n) : NULL;
+        ok = lv->band && lv->linear && (i == 0 || lv->bytes);
+        if (ok && i + 1 < hdr.levelCount){
+            buildFilterTable(&lv->fx, mipFilter, lv->w, lv->w / 2);
+            buildFilterTable(&lv->fy, mipFilter, lv->h, lv->h / 2);
+            lv->ring = VT_BUILD_ROWS + lv->fy.taps;
+            lv->tmp = (float*)malloc((size_t)lv->ring * (lv->w / 2) * 4 * sizeof(float));
+            ok = lv->tmp != NULL;
+        }
+    }
+
+    char tmp[320];
+    snprintf(tmp, sizeof(tmp), "%s.%p.tmp", pagePath, (void*)&tmp);
+    makeDirs(TEXCACHE_DIR);
+    if (ok){
+        b.f = fopen(tmp, "wb");
+        ok = b.f != NULL;
+    }
+    if (b.f){
+        static const unsigned char zeros[VT_DATA_ALIGN];
+        ok = ok && fwrite(&hdr, sizeof(hdr), 1, b.f) == 1
+          && fwrite(zeros, 1, (size_t)hdr.dataOffset - sizeof(hdr), b.f) == (size_t)hdr.dataOffset - sizeof(hdr);
+        for (int y = 0; ok && y < h; y += VT_BUILD_ROWS){
+            int count = h - y < VT_BUILD_ROWS ? h - y : VT_BUILD_ROWS;
+            const unsigned char* rows = src->read(src, count);
+            ok = rows && feedPageLevel(&b, 0, rows, NULL, count);
+        }
+        ok = (fclose(b.f) == 0) && ok;
+        if (ok) ok = replaceFile(tmp, pagePath);
+        if (!ok) remove(tmp);
+    }
+    if (!ok) printf("Aviso: nao foi possivel gravar o page file %s\n", pagePath);
+    for (uint32_t i = 0; i < hdr.levelCount; ++i){
+        VTLevelBuild* lv = &b.levels[i];
+        free(lv->band); free(lv->linear); free(lv->bytes); free(lv->tmp);
+        freeFilterTable(&lv->fx);
+        freeFilterTable(&lv->fy);
+    }
+    free(b.page);
+    return ok;
+}
+
+static int readPageHeader(FILE* f, VTHeader* hdr, uint64_t hash){
+    if (!readFileAt(f, 0, hdr, sizeof(*hdr))) return 0;
+    if (hdr->magic != VT_MAGIC || hdr->version != VT_VERSION || hdr->sourceHash != hash) return 0;
+    return hdr->levelCount >= 1 && hdr->levelCount <= TEXTURE_MAX_LEVELS;
+}
+
+// Thread do VT: abre (ou monta) o page file e prepara o estado dos tiles.
+static int openPageFile(VirtualTexture* vt){
+    AssetView src;
+    if (!openAsset(vt->path, &src)){ printf("Falha ao carregar textura: %s\n", vt->path); return 0; }
+    const uint32_t keyInfo[2] = {VT_VERSION, (uint32_t)mipFilter};
+    uint64_t hash = hashBytes(src.data, src.size, hashBytes(keyInfo, sizeof(keyInfo), HASH_SEED));
+    char pagePath[300];
+    snprintf(pagePath, sizeof(pagePath), TEXCACHE_DIR "/%016llx.vt", (unsigned long long)hash);
+
+    FILE* f = fopen(pagePath, "rb");
+    int valid = f && readPageHeader(f, &vt->hdr, hash);
+    if (f) fclose(f);
+    if (!valid){
+        ScanlineSource lines;
+        int built = 0;
+        decodeArenaBegin();
+        if (openScanlines(src.data, src.size, &lines)){
+            built = buildPageFile(pagePath, &lines, hash);
+            lines.close(&lines);
+        }
+        decodeArenaEnd();
+        if (built && (f = fopen(pagePath, "rb")) != NULL){
+            valid = readPageHeader(f, &vt->hdr, hash);
+            fclose(f);
+        }
+    }
+    closeAsset(&src);
+    if (!valid || !ioOpen(pagePath, 1, &vt->file, NULL)){ printf("Falha ao carregar textura virtual: %s\n", vt->path); return 0; }
+
+    const VTHeader* hdr = &vt->hdr;
+    uint32_t last = hdr->levelCount - 1;
+    vt->tileCount = hdr->firstTile[last] + hdr->tilesX[last] * hdr->tilesY[last];
+    vt->state    = (unsigned char*)calloc(vt->tileCount, 1);
+    vt->lastUsed = (unsigned*)calloc(vt->tileCount, sizeof(unsigned));
+    vt->slot     = (short*)malloc(vt->tileCount * sizeof(short));
+    vt->entries  = (unsigned char*)calloc(vt->tileCount, 4);
+    for (uint32_t i = 0; i < vt->tileCount; ++i) vt->slot[i] = -1;
+    return 1;
+}
+
+static int compareRequestLevel(const void* a, const void* b){
+    return ((const VTRequest*)b)->level - ((const VTRequest*)a)->level;   // grossos primeiro
+}
+
+static void pushRequest(VTRequest** list, size_t* count, size_t* cap, VirtualTexture* vt, uint32_t tile, int level){
+    if (*count == *cap){
+        *cap = *cap ? *cap * 2 : 256;
+        *list = (VTRequest*)realloc(*list, *cap * sizeof(VTRequest));
+    }
+    (*list)[(*count)++] = (VTRequest){vt, tile, level};
+}
+
+static void vtThreadMain(void* arg){
+    (void)arg;
+    VTRequest* requests = NULL;
+    size_t requestCap = 0;
+    mutexLock(&vtLock);
+    for (;;){
+        VirtualTexture* pending = NULL;
+        for (int i = 0; i < vtCount && !pending; ++i)
+            if (!vtList[i]->opened && !vtList[i]->failed) pending = vtList[i];
+        if (pending && !vtQuit){
+            mutexUnlock(&vtLock);
+            int ok = openPageFile(pending);
+            mutexLock(&vtLock);
+            if (ok) pending->opened = 1; else pending->failed = 1;
+            vtKick = 1;   // carrega já o nível mais grosso
+            continue;
+        }
+        if (vtQuit) break;
+        if (!vtFeedbackPending && !vtKick){ condWait(&vtWake, &vtLock); continue; }
+
+        // Pedidos do feedback: o tile e seus ancestrais (fallback), sem repetir
+        size_t requestCount = 0;
+        unsigned frame = vtFeedbackFrame;
+        for (size_t p = 0; vtFeedbackPending && p < vtFeedbackPixels; ++p){
+            const unsigned char* px = vtFeedback + p * 4;
+            if (px[3] == 0 || px[3] > vtCount) continue;
+            VirtualTexture* vt = vtList[px[3] - 1];
+            if (!vt->opened) continue;
+            int level = px[2] >> 4;
+            uint32_t tx = px[0] | (uint32_t)((px[2] >> 2) & 3) << 8;
+            uint32_t ty = px[1] | (uint32_t)(px[2] & 3) << 8;
+            for (; level < (int)vt->hdr.levelCount; ++level, tx >>= 1, ty >>= 1){
+                if (tx >= vt->hdr.tilesX[level] || ty >= vt->hdr.tilesY[level]) break;
+                uint32_t idx = vt->hdr.firstTile[level] + ty * vt->hdr.tilesX[level] + tx;
+                if (vt->lastUsed[idx] == frame) break;   // ancestrais já marcados
+                vt->lastUsed[idx] = frame;
+                if (vt->state[idx] == TILE_ABSENT) pushRequest(&requests, &requestCount, &requestCap, vt, idx, level);
+            }
+        }
+        if (vtFeedbackPending) vtLastFeedbackFrame = frame;
+        vtFeedbackPending = 0;
+        vtKick = 0;
+        // Nível mais grosso sempre residente
+        for (int i = 0; i < vtCount; ++i){
+            VirtualTexture* vt = vtList[i];
+            if (!vt->opened) continue;
+            uint32_t last = vt->hdr.levelCount - 1;
+            for (uint32_t idx = vt->hdr.firstTile[last]; idx < vt->tileCount; ++idx)
+                if (vt->state[idx] == TILE_ABSENT) pushRequest(&requests, &requestCount, &requestCap, vt, idx, (int)last);
+        }
+        qsort(requests, requestCount, sizeof(VTRequest), compareRequestLevel);
+        if (requestCount > (size_t)vtStagingFreeCount) requestCount = (size_t)vtStagingFreeCount;
+        int staging[VT_STAGING_TILES];
+        for (size_t r = 0; r < requestCount; ++r){
+            staging[r] = vtStagingFree[--vtStagingFreeCount];
+            requests[r].vt->state[requests[r].tile] = TILE_LOADING;
+        }
+        mutexUnlock(&vtLock);
+
+        // Todas as leituras saem juntas; cada tile fica pronto para upload ao chegar
+        IoRequest reads[VT_STAGING_TILES];
+        IoRequest* batch[VT_STAGING_TILES];
+        for (size_t r = 0; r < requestCount; ++r){
+            VirtualTexture* vt = requests[r].vt;
+            reads[r] = (IoRequest){vt->file, vt->hdr.dataOffset + (uint64_t)requests[r].tile * VT_TILE_STRIDE,
+                                   vtStaging[staging[r]], (uint32_t)VT_TILE_STRIDE, 0, &vtIoDone, NULL};
+            batch[r] = &reads[r];
+        }
+        ioSubmit(batch, (int)requestCount);
+
+        mutexLock(&vtLock);
+        for (size_t done = 0; done < requestCount; ++done){
+            mutexUnlock(&vtLock);
+            IoRequest* io = ioQueuePop(&vtIoDone, 1);
+            mutexLock(&vtLock);
+            size_t r = (size_t)(io - reads);
+            if (io->result == (int32_t)VT_TILE_STRIDE){
+                vtReady[vtReadyCount++] = (VTReady){requests[r].vt, requests[r].tile, staging[r]};
+                requests[r].vt->state[requests[r].tile] = TILE_READY;
+            } else {
+                vtStagingFree[vtStagingFreeCount++] = staging[r];
+                requests[r].vt->state[requests[r].tile] = TILE_ABSENT;
+            }
+        }
+    }
+    mutexUnlock(&vtLock);
+    free(requests);
+}
+
+static int startVirtualTexturing(void){
+    vtProgram         = acquireShaderProgram("assets/shaders/object_vertex.glsl", "assets/shaders/object_vt_fragment.glsl", NULL);
+    vtFeedbackProgram = acquireShaderProgram("assets/shaders/object_vertex.glsl", "assets/shaders/vt_feedback_fragment.glsl", NULL);
+    if (!vtProgram || !vtFeedbackProgram){   // sem os shaders o planeta fica com a textura comum
+        releaseShaderProgram(vtProgram);
+        releaseShaderProgram(vtFeedbackProgram);
+        vtProgram = vtFeedbackProgram = NULL;
+        return 0;
+    }
+
+    glGenTextures(1, &vtPhysTex);
+    glBindTexture(GL_TEXTURE_2D, vtPhysTex);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, VT_PHYS_SLOTS * VT_PAGE, VT_PHYS_SLOTS * VT_PAGE, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glGenFramebuffers(1, &vtFbo);
+    glGenRenderbuffers(1, &vtFbColor);
+    glGenRenderbuffers(1, &vtFbDepth);
+    glGenBuffers(VT_READBACK_RING, vtReadPBO);
+
+    for (int i = 0; i < VT_STAGING_TILES; ++i){
+        vtStaging[i] = (unsigned char*)ioAllocAligned(VT_TILE_STRIDE);
+        vtStagingFree[vtStagingFreeCount++] = i;
+    }
+    mutexInit(&vtLock);
+    condInit(&vtWake);
+    ioQueueInit(&vtIoDone);
+    threadStart(&vtThread, vtThreadMain, NULL);
+    vtStarted = 1;
+    return 1;
+}
+
+VirtualTexture* loadVirtualTexture(const char* path){
+    if (!vtStarted && !startVirtualTexturing()) return NULL;
+    if (vtCount == VT_MAX_TEXTURES){ printf("Limite de texturas virtuais atingido: %s\n", path); return NULL; }
+    VirtualTexture* vt = (VirtualTexture*)calloc(1, sizeof(VirtualTexture));
+    snprintf(vt->path, sizeof(vt->path), "%s", path);
+    mutexLock(&vtLock);
+    vt->id = vtCount;
+    vtList[vtCount++] = vt;
+    condBroadcast(&vtWake);
+    mutexUnlock(&vtLock);
+    return vt;
+}
+
+void shutdownVirtualTexturing(void){
+    if (!vtStarted) return;
+    mutexLock(&vtLock);
+    vtQuit = 1;
+    condBroadcast(&vtWake);
+    mutexUnlock(&vtLock);
+    threadJoin(vtThread);
+    for (int i = 0; i < vtCount; ++i) if (vtList[i]->opened) ioClose(vtList[i]->file);
+}
+
+// Página física para um tile novo: livre ou a usada há mais tempo, nunca do nível mais
+// grosso nem pedida no último feedback. -1 se todas estão em uso.
+static int claimSlot(void){
+    int best = -1;
+    unsigned bestUsed = 0;
+    for (int s = 0; s < VT_PHYS_SLOTS * VT_PHYS_SLOTS; ++s){
+        VirtualTexture* vt = vtSlots[s].vt;
+        if (!vt) return s;
+        uint32_t last = vt->hdr.levelCount - 1;
+        if (vtSlots[s].tile >= vt->hdr.firstTile[last]) continue;
+        unsigned used = vt->lastUsed[vtSlots[s].tile];
+        if (used >= vtLastFeedbackFrame) continue;
+        if (best < 0 || used < bestUsed){ best = s; bestUsed = used; }
+    }
+    if (best >= 0){
+        VirtualTexture* vt = vtSlots[best].vt;
+        vt->state[vtSlots[best].tile] = TILE_ABSENT;
+        vt->slot[vtSlots[best].tile] = -1;
+        vt->dirty = 1;
+        vtSlots[best].vt = NULL;
+    }
+    return best;
+}
+
+// Cada entrada aponta para a própria página ou herda a do pai (nível acima).
+static void rebuildPageTable(VirtualTexture* vt){
+    const VTHeader* h = &vt->hdr;
+    for (int level = (int)h->levelCount - 1; level >= 0; --level){
+        for (uint32_t ty = 0; ty < h->tilesY[level]; ++ty){
+            for (uint32_t tx = 0; tx < h->tilesX[level]; ++tx){
+                uint32_t idx = h->firstTile[level] + ty * h->tilesX[level] + tx;
+                unsigned char* e = vt->entries + (size_t)idx * 4;
+                if (vt->state[idx] == TILE_RESIDENT){
+                    e[0] = (unsigned char)(vt->slot[idx] % VT_PHYS_SLOTS);
+                    e[1] = (unsigned char)(vt->slot[idx] / VT_PHYS_SLOTS);
+                    e[2] = (unsigned char)level;
+                    e[3] = 255;
+                } else if (level + 1 < (int)h->levelCount){
+                    uint32_t parent = h->firstTile[level + 1] + (ty >> 1) * h->tilesX[level + 1] + (tx >> 1);
+                    memcpy(e, vt->entries + (size_t)parent * 4, 4);
+                } else {
+                    memset(e, 0, 4);
+                }
+            }
+        }
+    }
+}
+
+// Chamado uma vez por quadro: recolhe o feedback pronto, envia tiles e atualiza page tables.
+void updateVirtualTextures(void){
+    if (!vtStarted) return;
+    ++vtFrame;
+
+    // Readback mais recente primeiro; se a thread ainda está ocupada, o quadro é descartado
+    for (int k = 1; k <= VT_READBACK_RING; ++k){
+        int i = (vtReadNext - k + VT_READBACK_RING) % VT_READBACK_RING;
+        if (!vtReadFence[i]) continue;
+        GLenum status = glClientWaitSync(vtReadFence[i], 0, 0);
+        if (status == GL_TIMEOUT_EXPIRED) continue;
+        glDeleteSync(vtReadFence[i]);
+        vtReadFence[i] = NULL;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, vtReadPBO[i]);
+        const unsigned char* data = (const unsigned char*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0,
+                                        (GLsizeiptr)(vtReadPixels[i] * 4), GL_MAP_READ_BIT);
+        if (data){
+            mutexLock(&vtLock);
+            if (!vtFeedbackPending){
+                if (vtFeedbackCap < vtReadPixels[i] * 4){
+                    vtFeedbackCap = vtReadPixels[i] * 4;
+                    vtFeedback = (unsigned char*)realloc(vtFeedback, vtFeedbackCap);
+                }
+                memcpy(vtFeedback, data, vtReadPixels[i] * 4);
+                vtFeedbackPixels = vtReadPixels[i];
+                vtFeedbackFrame = vtReadFrame[i];
+                vtFeedbackPending = 1;
+                condBroadcast(&vtWake);
+            }
+            mutexUnlock(&vtLock);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+
+    // Escolhe páginas sob o lock; o envio em si fica fora dele
+    VTReady batch[VT_UPLOADS_PER_FRAME];
+    int batchSlots[VT_UPLOADS_PER_FRAME];
+    int batchCount = 0;
+    mutexLock(&vtLock);
+    while (vtReadyCount > 0 && batchCount < VT_UPLOADS_PER_FRAME){
+        VTReady r = vtReady[0];
+        memmove(vtReady, vtReady + 1, (size_t)--vtReadyCount * sizeof(VTReady));
+        int s = claimSlot();
+        if (s < 0){   // cache físico todo em uso: volta a ser pedido no próximo feedback
+            r.vt->state[r.tile] = TILE_ABSENT;
+            vtStagingFree[vtStagingFreeCount++] = r.staging;
+            continue;
+        }
+        vtSlots[s].vt = r.vt;
+        vtSlots[s].tile = r.tile;
+        r.vt->slot[r.tile] = (short)s;
+        r.vt->state[r.tile] = TILE_RESIDENT;
+        r.vt->dirty = 1;
+        batch[batchCount] = r;
+        batchSlots[batchCount++] = s;
+    }
+    int opened[VT_MAX_TEXTURES];
+    for (int i = 0; i < vtCount; ++i){
+        opened[i] = vtList[i]->opened;
+        if (opened[i] && vtList[i]->dirty) rebuildPageTable(vtList[i]);
+    }
+    mutexUnlock(&vtLock);
+
+    glBindTexture(GL_TEXTURE_2D, vtPhysTex);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (int i = 0; i < batchCount; ++i){
+        int s = batchSlots[i];
+        glTexSubImage2D(GL_TEXTURE_2D, 0, (s % VT_PHYS_SLOTS) * VT_PAGE, (s / VT_PHYS_SLOTS) * VT_PAGE,
+                        VT_PAGE, VT_PAGE, GL_RGBA, GL_UNSIGNED_BYTE, vtStaging[batch[i].staging]);
+    }
+    if (batchCount > 0){
+        mutexLock(&vtLock);
+        for (int i = 0; i < batchCount; ++i) vtStagingFree[vtStagingFreeCount++] = batch[i].staging;
+        mutexUnlock(&vtLock);
+    }
+
+    for (int i = 0; i < vtCount; ++i){
+        VirtualTexture* vt = vtList[i];
+        if (!opened[i]) continue;
+        const VTHeader* h = &vt->hdr;
+        if (!vt->pageTable){
+            glGenTextures(1, &vt->pageTable);
+            glBindTexture(GL_TEXTURE_2D, vt->pageTable);
+            for (uint32_t l = 0; l < h->levelCount; ++l)
+                glTexImage2D(GL_TEXTURE_2D, (GLint)l, GL_RGBA8, (GLsizei)h->tilesX[l], (GLsizei)h->tilesY[l], 0,
+                             GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)h->levelCount - 1);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            vt->dirty = 1;
+        }
+        if (!vt->dirty) continue;
+        vt->dirty = 0;
+        glBindTexture(GL_TEXTURE_2D, vt->pageTable);
+        for (uint32_t l = 0; l < h->levelCount; ++l)
+            glTexSubImage2D(GL_TEXTURE_2D, (GLint)l, 0, 0, (GLsizei)h->tilesX[l], (GLsizei)h->tilesY[l],
+                            GL_RGBA, GL_UNSIGNED_BYTE, vt->entries + (size_t)h->firstTile[l] * 4);
+    }
+}
+
+GLuint virtualTextureProgram(void){ return vtProgram->id; }
+
+// Liga page table e cache físico no programa atual e agenda o objeto para o feedback.
+void bindVirtualTexture(VirtualTexture* vt, GLuint shader, mat4 model, const Mesh* mesh, int lod){
+    const VTHeader* h = &vt->hdr;
+    int ready = vt->pageTable != 0;
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, vt->pageTable);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, vtPhysTex);
+    glActiveTexture(GL_TEXTURE0);
+    glUniform1i(glGetUniformLocation(shader, "pageTable"), 1);
+    glUniform1i(glGetUniformLocation(shader, "physTex"), 2);
+    glUniform2f(glGetUniformLocation(shader, "vtSize"), (float)h->width, (float)h->height);
+    glUniform1f(glGetUniformLocation(shader, "vtLevels"), ready ? (float)h->levelCount : 0.0f);
+    glUniform3f(glGetUniformLocation(shader, "vtPage"), (float)VT_TILE, (float)VT_BORDER, (float)(VT_PHYS_SLOTS * VT_PAGE));
+
+    if (ready && vtDrawCount < VT_FEEDBACK_DRAWS){
+        VTDraw* d = &vtDraws[vtDrawCount++];
+        d->vt = vt;
+        glm_mat4_copy(model, d->model);
+        d->mesh = mesh;
+        d->lod = lod;
+    }
+}
+
+// Redesenha os objetos com textura virtual em baixa resolução gravando o tile pedido
+// por pixel e inicia a leitura assíncrona para um PBO.
+void renderVirtualTextureFeedback(mat4 projection, mat4 view){
+    int count = vtDrawCount;
+    vtDrawCount = 0;
+    if (!vtStarted || count == 0 || !shaderProgramReady(vtFeedbackProgram->id)) return;
+    int slot = vtReadNext;
+    if (vtReadFence[slot]) return;   // PBO ainda não foi lido
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    int fw = viewport[2] / VT_FEEDBACK_DIV, fh = viewport[3] / VT_FEEDBACK_DIV;
+    if (fw < 1) fw = 1;
+    if (fh < 1) fh = 1;
+    glBindFramebuffer(GL_FRAMEBUFFER, vtFbo);
+    if (fw != vtFbW || fh != vtFbH){
+        glBindRenderbuffer(GL_RENDERBUFFER, vtFbColor);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, fw, fh);
+        glBindRenderbuffer(GL_RENDERBUFFER, vtFbDepth);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, fw, fh);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, vtFbColor);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, vtFbDepth);
+        vtFbW = fw; vtFbH = fh;
+    }
+    glViewport(0, 0, fw, fh);
+    glDisable(GL_BLEND);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    GLuint prog = vtFeedbackProgram->id;
+    mat4 viewProj;
+    glm_mat4_mul(projection, view, viewProj);
+    glUseProgram(prog);
+    glUniform1f(glGetUniformLocation(prog, "vtTile"), (float)VT_TILE);
+    glUniform1f(glGetUniformLocation(prog, "lodBias"), -log2f((float)VT_FEEDBACK_DIV));
+    for (int i = 0; i < count; ++i){
+        VTDraw* d = &vtDraws[i];
+        const VTHeader* h = &d->vt->hdr;
+        setTransformUniforms(prog, d->model, viewProj);
+        glUniform2f(glGetUniformLocation(prog, "vtSize"), (float)h->width, (float)h->height);
+        glUniform1f(glGetUniformLocation(prog, "vtLevels"), (float)h->levelCount);
+        glUniform1f(glGetUniformLocation(prog, "vtId"), (float)(d->vt->id + 1));
+        glBindVertexArray(d->mesh->vao);
+        glDrawElements(GL_TRIANGLES, d->mesh->lods[d->lod].indexCount, GL_UNSIGNED_INT,
+                       (void*)d->mesh->lods[d->lod].indexOffset);
+    }
+
+    size_t pixels = (size_t)fw * fh;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, vtReadPBO[slot]);
+    if (vtReadCap[slot] < pixels * 4){
+        glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)(pixels * 4), NULL, GL_STREAM_READ);
+        vtReadCap[slot] = pixels * 4;
+    }
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, fw, fh, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    vtReadFence[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    vtReadPixels[slot] = pixels;
+    vtReadFrame[slot] = vtFrame;
+    vtReadNext = (slot + 1) % VT_READBACK_RING;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    glEnable(GL_BLEND);
+}
+
+// --- Malhas (VAO + cadeia de LODs) ---
+// Todos os LODs compartilham o mesmo VBO; cada nível é só uma faixa do EBO.
+void createMesh(Mesh* mesh, const float* vertices, unsigned int vertexCount,
+                const unsigned int* indices, unsigned int indexCount, int buildLods){
+    unsigned int* lodIdx = (unsigned int*)malloc((size_t)indexCount * MESH_MAX_LODS * sizeof(unsigned int));
+    memcpy(lodIdx, indices, indexCount * sizeof(unsigned int));
+
+    mesh->lodCount = 1;
+    mesh->lods[0].indexCount  = (GLsizei)indexCount;
+    mesh->lods[0].indexOffset = 0;
+    mesh->lods[0].error       = 0.0f;
+
+    unsigned int total = indexCount;
+    while (buildLods && mesh->lodCount < MESH_MAX_LODS){
+        const MeshLOD* prev = &mesh->lods[mesh->lodCount - 1];
+        unsigned int prevCount = (unsigned int)prev->indexCount;
+        if (prevCount / 3 <= MESH_LOD_MIN_TRIS) break;
+
+        unsigned int target = (prevCount / 2) / 3 * 3;
+        float err = 0.0f;
+        unsigned int* dst = lodIdx + total;
+        unsigned int count = simplifyMesh(vertices, vertexCount, lodIdx + prev->indexOffset / sizeof(unsigned int),
+                                          prevCount, target, dst, &err);
+        if (count == 0 || count > prevCount * 9 / 10) break; // não reduziu o bastante (vértices travados)
+
+        MeshLOD* lod = &mesh->lods[mesh->lodCount++];
+        lod->indexCount  = (GLsizei)count;
+        lod->indexOffset = total * sizeof(unsigned int);
+        lod->error       = prev->error + err;  // erros de colapsos sucessivos se acumulam
+        total += count;
+    }
+
+    glGenVertexArrays(1, &mesh->vao);
+    glGenBuffers(1, &mesh->vbo);
+    glGenBuffers(1, &mesh->ebo);
+
+    glBindVertexArray(mesh->vao);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh->vbo);
+    glBufferData(GL_ARRAY_BUFFER, vertexCount * 8 * sizeof(float), vertices, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, total * sizeof(unsigned int), lodIdx, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
+    glEnableVertexAttribArray(2);
+    free(lodIdx);
+}
+
+static ResourceMap meshesByContent;   // hash da geometria -> Mesh
+static ResourceMap meshesByParams;    // hash dos parâmetros do gerador -> Mesh
+
+Mesh* acquireMesh(const float* vertices, unsigned int vertexCount,
+                  const unsigned int* indices, unsigned int indexCount, int buildLods){
+    uint64_t counts[3] = {vertexCount, indexCount, (uint64_t)(buildLods != 0)};
+    uint64_t key = hashBytes(indices, (size_t)indexCount * sizeof(unsigned int),
+                             hashBytes(vertices, (size_t)vertexCount * 8 * sizeof(float),
+                                       hashBytes(counts, sizeof(counts), HASH_SEED)));
+    Mesh* mesh = (Mesh*)resourceFind(&meshesByContent, key);
+    if (mesh){ mesh->refCount++; return mesh; }
+    mesh = (Mesh*)calloc(1, sizeof(Mesh));
+    createMesh(mesh, vertices, vertexCount, indices, indexCount, buildLods);
+    mesh->refCount = 1;
+    mesh->contentKey = key;
+    resourceInsert(&meshesByContent, key, mesh);
+    return mesh;
+}
+
+// Chave dos geradores: tipo + parâmetros, sem gerar a geometria de novo.
+static uint64_t meshParamsKey(char kind, float a, float b, int c, int d, int buildLods){
+    struct { char kind; float a, b; int c, d, lods; } p;
+    memset(&p, 0, sizeof(p));   // padding zerado para o hash
+    p.kind = kind; p.a = a; p.b = b; p.c = c; p.d = d; p.lods = buildLods != 0;
+    return hashBytes(&p, sizeof(p), HASH_SEED);
+}
+
+Mesh* acquireSphereMesh(float radius, int sectorCount, int stackCount, int buildLods){
+    uint64_t key = meshParamsKey('S', radius, 0.0f, sectorCount, stackCount, buildLods);
+    Mesh* mesh = (Mesh*)resourceFind(&meshesByParams, key);
+    if (mesh){ mesh->refCount++; return mesh; }
+    float* verts; unsigned int vcount;
+    unsigned int* idx; unsigned int icount;
+    generateSphere(radius, sectorCount, stackCount, &verts, &vcount, &idx, &icount);
+    mesh = acquireMesh(verts, vcount, idx, icount, buildLods);
+    free(verts);
+    free(idx);
+    resourceInsert(&meshesByParams, key, mesh);
+    return mesh;
+}
+
+Mesh* acquireRingMesh(float innerR, float outerR, int segments, int buildLods){
+    uint64_t key = meshParamsKey('R', innerR, outerR, segments, 0, buildLods);
+    Mesh* mesh = (Mesh*)resourceFind(&meshesByParams, key);
+    if (mesh){ mesh->refCount++; return mesh; }
+    float* verts; unsigned int vcount;
+    unsigned int* idx; unsigned int icount;
+    generateRing(innerR, outerR, segments, &verts, &vcount, &idx, &icount);
+    mesh = acquireMesh(verts, vcount, idx, icount, buildLods);
+    free(verts);
+    free(idx);
+    resourceInsert(&meshesByParams, key, mesh);
+    return mesh;
+}
+
+void releaseMesh(Mesh* mesh){
+    if (!mesh || --mesh->refCount > 0) return;
+    resourceRemoveValue(&meshesByParams, mesh);
+    resourceRemove(&meshesByContent, mesh->contentKey);
+    glDeleteVertexArrays(1, &mesh->vao);
+    glDeleteBuffers(1, &mesh->vbo);
+    glDeleteBuffers(1, &mesh->ebo);
+    free(mesh);
+}
+
+// Esfera dentro (ou cortando) o frustum de projection * view.
+static int sphereVisible(mat4 projection, mat4 view, vec3 center, float radius){
+    mat4 viewProj;
+    vec4 planes[6];
+    glm_mat4_mul(projection, view, viewProj);
+    glm_frustum_planes(viewProj, planes);   // normalizados, normais para dentro
+    for (int i = 0; i < 6; ++i)
+        if (glm_vec3_dot(planes[i], center) + planes[i][3] < -radius) return 0;
+    return 1;
+}
+
+// Tamanho aproximado na tela (pixels) de um comprimento a 'distance' da câmera.
+static float screenRadiusPx(float worldRadius, float distance){
+    if (distance < 1e-4f) return (float)winH;
+    return worldRadius * ((float)winH * 0.5f) / tanf(glm_rad(fovDeg) * 0.5f) / distance;
+}
+
+// Escolhe o LOD mais grosso cujo erro projetado fica abaixo de lodErrorPx pixels (preset).
+static int selectMeshLOD(const Mesh* mesh, float worldScale, float distance){
+    if (distance < 1e-4f) return 0;
+    int lod = 0;
+    for (int i = 1; i < mesh->lodCount; ++i)
+        if (screenRadiusPx(mesh->lods[i].error * worldScale, distance) <= quality->lodErrorPx) lod = i;
+    return lod;
+}
+
+// --- Transformações dos corpos (SoA) ---
+// model = Rx(inclinação) · T(órbita) · Rx(90°) · Rz(tilt + spin) · S(escala): o
+// tilt gira no mesmo eixo do spin, então vira só uma fase. Multiplicando à mão
+// sobram um seno/cosseno por ângulo e algumas multiplicações por coluna; a
+// normal é R/k (rotação com escala uniforme), sem inversa nenhuma.
+void initBodyTransforms(BodyTransforms* xf, int capacity){
+    memset(xf, 0, sizeof(*xf));
+    xf->capacity = capacity;
+    float** fields[] = {&xf->orbitRadius, &xf->orbitRate, &xf->cosIncl, &xf->sinIncl,
+                        &xf->spinPhase, &xf->spinRate, &xf->scale};
+    for (int i = 0; i < (int)(sizeof(fields) / sizeof(fields[0])); ++i)
+        *fields[i] = (float*)calloc((size_t)capacity, sizeof(float));
+    xf->model  = (mat4*)ioAllocAligned((size_t)capacity * sizeof(mat4));   // cglm quer 16 (32 com AVX)
+    xf->mvp    = (mat4*)ioAllocAligned((size_t)capacity * sizeof(mat4));
+    xf->normal = (mat3*)malloc((size_t)capacity * sizeof(mat3));
+}
+
+void freeBodyTransforms(BodyTransforms* xf){
+    free(xf->orbitRadius); free(xf->orbitRate); free(xf->cosIncl); free(xf->sinIncl);
+    free(xf->spinPhase);   free(xf->spinRate);  free(xf->scale);
+    ioFreeAligned(xf->model);
+    ioFreeAligned(xf->mvp);
+    free(xf->normal);
+    memset(xf, 0, sizeof(*xf));
+}
+
+int addBody(BodyTransforms* xf, float orbitRadius, float orbitSpeedDeg, float orbitInclDeg,
+            float axialTiltDeg, float spinDeg, float scale){
+    if (xf->count == xf->capacity) return -1;
+    int i = xf->count++;
+    xf->orbitRadius[i] = orbitRadius;
+    xf->orbitRate[i]   = glm_rad(orbitSpeedDeg);
+    xf->cosIncl[i]     = cosf(glm_rad(orbitInclDeg));
+    xf->sinIncl[i]     = sinf(glm_rad(orbitInclDeg));
+    xf->spinPhase[i]   = glm_rad(axialTiltDeg);
+    xf->spinRate[i]    = glm_rad(spinDeg);
+    xf->scale[i]       = scale;
+    return i;
+}
+
+typedef struct {
+    BodyTransforms* xf;
+    float t;
+    mat4  viewProj;
+} TransformJob;
+
+static void transformRange(void* ctx, int begin, int end){
+    TransformJob* job = (TransformJob*)ctx;
+    BodyTransforms* xf = job->xf;
+    const float t = job->t;
+    for (int i = begin; i < end; ++i){
+        float orbit = t * xf->orbitRate[i], spin = xf->spinPhase[i] + t * xf->spinRate[i];
+        float co = cosf(orbit), so = sinf(orbit), cs = cosf(spin), ss = sinf(spin);
+        float ci = xf->cosIncl[i], si = xf->sinIncl[i], k = xf->scale[i], r = xf->orbitRadius[i];
+
+        float* m = xf->model[i][0];   // colunas, como o GL
+        m[0]  =  k * cs;  m[1]  = -k * ss * si;  m[2]  =  k * ss * ci;  m[3]  = 0.0f;
+        m[4]  = -k * ss;  m[5]  = -k * cs * si;  m[6]  =  k * cs * ci;  m[7]  = 0.0f;
+        m[8]  =  0.0f;    m[9]  = -k * ci;       m[10] = -k * si;       m[11] = 0.0f;
+        m[12] =  r * co;  m[13] = -r * so * si;  m[14] =  r * so * ci;  m[15] = 1.0f;
+
+        float invK2 = 1.0f / (k * k);   // (kR)^-T = R/k = colunas de model / k²
+        float* n = xf->normal[i][0];
+        for (int c = 0; c < 3; ++c)
+            for (int j = 0; j < 3; ++j) n[c * 3 + j] = m[c * 4 + j] * invK2;
+
+        glm_mat4_mul(job->viewProj, xf->model[i], xf->mvp[i]);   // caminho SSE do cglm
+    }
+}
+
+void updateBodyTransforms(BodyTransforms* xf, float t, mat4 viewProj){
+    TransformJob job;
+    job.xf = xf;
+    job.t = t;
+    glm_mat4_copy(viewProj, job.viewProj);
+    if (xf->count < TRANSFORM_GRAIN) transformRange(&job, 0, xf->count);   // os planetas: não vale acordar workers
+    else parallelFor(&workers, xf->count, TRANSFORM_GRAIN, transformRange, &job);
+}
+
+// Para o que não passa pelo lote (Sol, anéis, feedback do VT): mesma interface de uniforms.
+void setTransformUniforms(GLuint shader, mat4 model, mat4 viewProj){
+    mat4 mvp;
+    mat3 linear, normal;
+    glm_mat4_mul(viewProj, model, mvp);
+    glm_mat4_pick3(model, linear);
+    glm_mat3_inv(linear, normal);
+    glm_mat3_transpose(normal);
+    glUniformMatrix4fv(glGetUniformLocation(shader, "model"), 1, GL_FALSE, (float*)model);
+    glUniformMatrix4fv(glGetUniformLocation(shader, "mvp"), 1, GL_FALSE, (float*)mvp);
+    glUniformMatrix3fv(glGetUniformLocation(shader, "normalMatrix"), 1, GL_FALSE, (float*)normal);
+}
+
+// --- Simplificação por quádricas de erro (QEM) ---
+// Colapso de meia-aresta: o vértice removido é trocado por um vizinho existente,
+// então posição, normal e UV nunca são interpolados. Vértices de borda e de
+// costura (mesma posição com normal/UV diferentes) ficam travados.
+// Quádricas ponderadas por área; 'w' guarda a área total para o erro virar
+// uma distância quadrática média (independente de quantos planos foram somados).
+typedef struct { double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2, w; } Quadric;
+
+typedef struct { float cost; unsigned int from, to; } Collapse;
+
+static void quadricAddPlane(Quadric* q, double a, double b, double c, double d, double w){
+    q->a2 += w*a*a; q->ab += w*a*b; q->ac += w*a*c; q->ad += w*a*d;
+    q->b2 += w*b*b; q->bc += w*b*c; q->bd += w*b*d;
+    q->c2 += w*c*c; q->cd += w*c*d; q->d2 += w*d*d;
+    q->w  += w;
+}
+
+static void quadricAdd(Quadric* dst, const Quadric* src){
+    dst->a2 += src->a2; dst->ab += src->ab; dst->ac += src->ac; dst->ad += src->ad;
+    dst->b2 += src->b2; dst->bc += src->bc; dst->bd += src->bd;
+    dst->c2 += src->c2; dst->cd += src->cd; dst->d2 += src->d2;
+    dst->w  += src->w;
+}
+
+// Média (por área) das distâncias ao quadrado de p aos planos acumulados em q e r.
+static double quadricError(const Quadric* q, const Quadric* r, const float* p){
+    double x = p[0], y = p[1], z = p[2];
+    double a2 = q->a2 + r->a2, ab = q->ab + r->ab, ac = q->ac + r->ac, ad = q->ad + r->ad;
+    double b2 = q->b2 + r->b2, bc = q->bc + r->bc, bd = q->bd + r->bd;
+    double c2 = q->c2 + r->c2, cd = q->cd + r->cd, d2 = q->d2 + r->d2;
+    double e = a2*x*x + 2*ab*x*y + 2*ac*x*z + 2*ad*x
+             + b2*y*y + 2*bc*y*z + 2*bd*y
+             + c2*z*z + 2*cd*z + d2;
+    double w = q->w + r->w;
+    return (e > 0.0 && w > 0.0) ? e / w : 0.0;
+}
+
+static int compareCollapse(const void* a, const void* b){
+    float ca = ((const Collapse*)a)->cost, cb = ((const Collapse*)b)->cost;
+    return (ca > cb) - (ca < cb);
+}
+
+static unsigned int hashVec3(const float* p){
+    unsigned int h[3]; memcpy(h, p, sizeof(h));
+    return (h[0] * 73856093u) ^ (h[1] * 19349663u) ^ (h[2] * 83492791u);
+}
+
+static unsigned int hashEdge(unsigned int a, unsigned int b){
+    return (a * 2654435761u) ^ (b * 40503u + 0x9e3779b9u);
+}
+
+// Verifica se mover 'from' para a posição de 'to' inverte algum triângulo vizinho.
+static int collapseFlips(const float* vertices, const unsigned int* idx,
+                         const unsigned int* adj, unsigned int adjBegin, unsigned int adjEnd,
+                         unsigned int from, unsigned int to){
+    for (unsigned int k = adjBegin; k < adjEnd; ++k){
+        const unsigned int* tri = idx + adj[k] * 3;
+        if (tri[0] == tri[1]) continue;                              // já removido
+        if (tri[0] == to || tri[1] == to || tri[2] == to) continue;  // vai degenerar (some)
+        vec3 p[3], q[3];
+        for (int c = 0; c < 3; ++c){
+            glm_vec3_copy((float*)(vertices + tri[c] * 8), p[c]);
+            glm_vec3_copy((float*)(vertices + (tri[c] == from ? to : tri[c]) * 8), q[c]);
+        }
+        vec3 e0, e1, n0, n1;
+        glm_vec3_sub(p[1], p[0], e0); glm_vec3_sub(p[2], p[0], e1); glm_vec3_cross(e0, e1, n0);
+        glm_vec3_sub(q[1], q[0], e0); glm_vec3_sub(q[2], q[0], e1); glm_vec3_cross(e0, e1, n1);
+        if (glm_vec3_dot(n0, n1) <= 0.2f * glm_vec3_norm(n0) * glm_vec3_norm(n1)) return 1;
+    }
+    return 0;
+}
+
+// Simplifica a malha (vértices no layout pos/normal/uv de 8 floats) até
+// targetIndexCount índices. outIndices precisa comportar indexCount índices.
+// Retorna a quantidade de índices escrita; outError recebe o erro máximo (distância).
+unsigned int simplifyMesh(const float* vertices, unsigned int vertexCount,
+                          const unsigned int* indices, unsigned int indexCount,
+                          unsigned int targetIndexCount, unsigned int* outIndices, float* outError){
+    unsigned int triCount = indexCount / 3;
+    unsigned int targetTris = targetIndexCount / 3;
+
+    unsigned int* idx       = (unsigned int*)malloc(indexCount * sizeof(unsigned int));
+    unsigned char* locked   = (unsigned char*)calloc(vertexCount, 1);
+    unsigned char* touched  = (unsigned char*)malloc(vertexCount);
+    Quadric* quadrics       = (Quadric*)calloc(vertexCount, sizeof(Quadric));
+    unsigned int* adjStart  = (unsigned int*)malloc((vertexCount + 1) * sizeof(unsigned int));
+    unsigned int* adj       = (unsigned int*)malloc(indexCount * sizeof(unsigned int));
+    Collapse* collapses     = (Collapse*)malloc(indexCount * sizeof(Collapse));
+    memcpy(idx, indices, indexCount * sizeof(unsigned int));
+
+    // Costuras: vértices distintos com a mesma posição
+    unsigned int tableSize = 1;
+    while (tableSize < vertexCount * 2) tableSize <<= 1;
+    unsigned int* table = (unsigned int*)malloc(tableSize * sizeof(unsigned int));
+    memset(table, 0xff, tableSize * sizeof(unsigned int));
+    for (unsigned int v = 0; v < vertexCount; ++v){
+        const float* p = vertices + v * 8;
+        unsigned int h = hashVec3(p) & (tableSize - 1);
+        while (table[h] != 0xffffffffu){
+            const float* o = vertices + table[h] * 8;
+            if (o[0] == p[0] && o[1] == p[1] && o[2] == p[2]){ locked[v] = locked[table[h]] = 1; break; }
+            h = (h + 1) & (tableSize - 1);
+        }
+        if (table[h] == 0xffffffffu) table[h] = v;
+    }
+    free(table);
+
+    // Bordas: aresta orientada (a,b) sem a gêmea (b,a)
+    unsigned int edgeTableSize = 1;
+    while (edgeTableSize < indexCount * 2) edgeTableSize <<= 1;
+    unsigned int* edges = (unsigned int*)malloc(edgeTableSize * 2 * sizeof(unsigned int));
+    memset(edges, 0xff, edgeTableSize * 2 * sizeof(unsigned int));
+    for (unsigned int i = 0; i < indexCount; ++i){
+        unsigned int a = idx[i], b = idx[i % 3 == 2 ? i - 2 : i + 1];
+        unsigned int h = hashEdge(a, b) & (edgeTableSize - 1);
+        while (edges[h * 2] != 0xffffffffu && !(edges[h * 2] == a && edges[h * 2 + 1] == b))
+            h = (h + 1) & (edgeTableSize - 1);
+        edges[h * 2] = a; edges[h * 2 + 1] = b;
+    }
+    for (unsigned int i = 0; i < indexCount; ++i){
+        unsigned int a = idx[i], b = idx[i % 3 == 2 ? i - 2 : i + 1];
+        unsigned int h = hashEdge(b, a) & (edgeTableSize - 1);
+        int found = 0;
+        while (edges[h * 2] != 0xffffffffu){
+            if (edges[h * 2] == b && edges[h * 2 + 1] == a){ found = 1; break; }
+            h = (h + 1) & (edgeTableSize - 1);
+        }
+        if (!found) locked[a] = locked[b] = 1;
+    }
+    free(edges);
+
+    // Quádrica de cada vértice = soma dos planos dos triângulos vizinhos
+    for (unsigned int t = 0; t < triCount; ++t){
+        vec3 e0, e1, n;
+        const float* p0 = vertices + idx[t*3] * 8;
+        glm_vec3_sub((float*)(vertices + idx[t*3+1] * 8), (float*)p0, e0);
+        glm_vec3_sub((float*)(vertices + idx[t*3+2] * 8), (float*)p0, e1);
+        glm_vec3_cross(e0, e1, n);
+        float area2 = glm_vec3_norm(n);
+        if (area2 < 1e-12f) continue;
+        glm_vec3_scale(n, 1.0f / area2, n);
+        double d = -(n[0]*p0[0] + n[1]*p0[1] + n[2]*p0[2]);
+        for (int c = 0; c < 3; ++c) quadricAddPlane(&quadrics[idx[t*3+c]], n[0], n[1], n[2], d, area2 * 0.5);
+    }
+
+    double maxError = 0.0;
+    while (triCount > targetTris){
+        // Adjacência vértice -> triângulos (CSR) dos triângulos ainda vivos
+        unsigned int liveIdx = triCount * 3;
+        memset(adjStart, 0, (vertexCount + 1) * sizeof(unsigned int));
+        for (unsigned int i = 0; i < liveIdx; ++i) adjStart[idx[i] + 1]++;
+        for (unsigned int v = 0; v < vertexCount; ++v) adjStart[v + 1] += adjStart[v];
+        for (unsigned int i = 0; i < liveIdx; ++i) adj[adjStart[idx[i]]++] = i / 3;
+        for (unsigned int v = vertexCount; v > 0; --v) adjStart[v] = adjStart[v - 1];
+        adjStart[0] = 0;
+
+        // Candidatos: cada aresta uma vez, na direção mais barata permitida
+        unsigned int candidateCount = 0;
+        for (unsigned int i = 0; i < liveIdx; ++i){
+            unsigned int a = idx[i], b = idx[i % 3 == 2 ? i - 2 : i + 1];
+            if (a > b) continue;
+            double cab = locked[a] ? -1.0 : quadricError(&quadrics[a], &quadrics[b], vertices + b * 8);
+            double cba = locked[b] ? -1.0 : quadricError(&quadrics[a], &quadrics[b], vertices + a * 8);
+            if (cab < 0.0 && cba < 0.0) continue;
+            Collapse* c = &collapses[candidateCount++];
+            if (cba < 0.0 || (cab >= 0.0 && cab <= cba)){ c->from = a; c->to = b; c->cost = (float)cab; }
+            else                                        { c->from = b; c->to = a; c->cost = (float)cba; }
+        }
+        if (candidateCount == 0) break;
+        qsort(collapses, candidateCount, sizeof(Collapse), compareCollapse);
+
+        // Aplica os colapsos mais baratos que não se sobrepõem nesta passada
+        memset(touched, 0, vertexCount);
+        unsigned int budget = (triCount - targetTris) / 4 + 1, applied = 0;
+        for (unsigned int k = 0; k < candidateCount && applied < budget && triCount > targetTris; ++k){
+            unsigned int from = collapses[k].from, to = collapses[k].to;
+            if (touched[from] || touched[to]) continue;
+            if (collapseFlips(vertices, idx, adj, adjStart[from], adjStart[from + 1], from, to)) continue;
+
+            for (unsigned int j = adjStart[from]; j < adjStart[from + 1]; ++j){
+                unsigned int* tri = idx + adj[j] * 3;
+                if (tri[0] == tri[1]) continue;
+                for (int c = 0; c < 3; ++c){ touched[tri[c]] = 1; if (tri[c] == from) tri[c] = to; }
+                if (tri[0] == tri[1] || tri[1] == tri[2] || tri[0] == tri[2]){
+                    tri[0] = tri[1] = tri[2] = to;   // marca como removido
+                    triCount--;
+                }
+            }
+            quadricAdd(&quadrics[to], &quadrics[from]);
+            if (collapses[k].cost > maxError) maxError = collapses[k].cost;
+            applied++;
+        }
+        if (applied == 0) break;
+
+        // Compacta, removendo os triângulos degenerados
+        unsigned int w = 0;
+        for (unsigned int i = 0; i < liveIdx; i += 3){
+            if (idx[i] == idx[i+1]) continue;
+            idx[w++] = idx[i]; idx[w++] = idx[i+1]; idx[w++] = idx[i+2];
+        }
+    }
+
+    memcpy(outIndices, idx, triCount * 3 * sizeof(unsigned int));
+    if (outError) *outError = (float)sqrt(maxError);
+
+    free(idx); free(locked); free(touched); free(quadrics);
+    free(adjStart); free(adj); free(collapses);
+    return triCount * 3;
+}
+
+// --- Threads ---
+typedef struct { void (*fn)(void*); void* arg; } ThreadStart;
+
+#ifdef _WIN32
+static DWORD WINAPI threadTrampoline(LPVOID p){
+    ThreadStart st = *(ThreadStart*)p; free(p);
+    st.fn(st.arg);
+    return 0;
+}
+void threadStart(Thread* t, void (*fn)(void*), void* arg){
+    ThreadStart* st = (ThreadStart*)malloc(sizeof(ThreadStart));
+    st->fn = fn; st->arg = arg;
+    *t = CreateThread(NULL, 0, threadTrampoline, st, 0, NULL);
+}
+void threadJoin(Thread t){ WaitForSingleObject(t, INFINITE); CloseHandle(t); }
+void mutexInit(Mutex* m){ InitializeCriticalSection(m); }
+void mutexDestroy(Mutex* m){ DeleteCriticalSection(m); }
+void mutexLock(Mutex* m){ EnterCriticalSection(m); }
+void mutexUnlock(Mutex* m){ LeaveCriticalSection(m); }
+void condInit(Cond* c){ InitializeConditionVariable(c); }
+void condWait(Cond* c, Mutex* m){ SleepConditionVariableCS(c, m, INFINITE); }
+void condBroadcast(Cond* c){ WakeAllConditionVariable(c); }
+int  cpuCount(void){ SYSTEM_INFO si; GetSystemInfo(&si); return (int)si.dwNumberOfProcessors; }
+double nowSeconds(void){
+    LARGE_INTEGER f, c;
+    QueryPerformanceFrequency(&f); QueryPerformanceCounter(&c);
+    return (double)c.QuadPart / (double)f.QuadPart;
+}
+#else
+static void* threadTrampoline(void* p){
+    ThreadStart st = *(ThreadStart*)p; free(p);
+    st.fn(st.arg);
+    return NULL;
+}
+void threadStart(Thread* t, void (*fn)(void*), void* arg){
+    ThreadStart* st = (ThreadStart*)malloc(sizeof(ThreadStart));
+    st->fn = fn; st->arg = arg;
+    pthread_create(t, NULL, threadTrampoline, st);
+}
+void threadJoin(Thread t){ pthread_join(t, NULL); }
+void mutexInit(Mutex* m){ pthread_mutex_init(m, NULL); }
+void mutexDestroy(Mutex* m){ pthread_mutex_destroy(m); }
+void mutexLock(Mutex* m){ pthread_mutex_lock(m); }
+void mutexUnlock(Mutex* m){ pthread_mutex_unlock(m); }
+void condInit(Cond* c){ pthread_cond_init(c, NULL); }
+void condWait(Cond* c, Mutex* m){ pthread_cond_wait(c, m); }
+void condBroadcast(Cond* c){ pthread_cond_broadcast(c); }
+int  cpuCount(void){ long n = sysconf(_SC_NPROCESSORS_ONLN); return n > 0 ? (int)n : 1; }
+double nowSeconds(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+#endif
+
+// --- Pool de workers ---
+static void workerLoop(void* arg){
+    JobPool* pool = (JobPool*)arg;
+    for (;;){
+        mutexLock(&pool->lock);
+        while (pool->count == 0 && !pool->quit) condWait(&pool->changed, &pool->lock);
+        if (pool->quit){ mutexUnlock(&pool->lock); return; }
+        Job job = pool->queue[pool->head];
+        pool->head = (pool->head + 1) % POOL_QUEUE_MAX;
+        pool->count--;
+        condBroadcast(&pool->changed);   // libera quem esperava vaga na fila
+        mutexUnlock(&pool->lock);
+        job.fn(job.arg);
+    }
+}
+
+void jobPoolStart(JobPool* pool, int threadCount){
+    memset(pool, 0, sizeof(*pool));
+    mutexInit(&pool->lock);
+    condInit(&pool->changed);
+    if (threadCount < 1) threadCount = 1;
+    if (threadCount > POOL_MAX_THREADS) threadCount = POOL_MAX_THREADS;
+    pool->threadCount = threadCount;
+    for (int i = 0; i < threadCount; ++i) threadStart(&pool->threads[i], workerLoop, pool);
+}
+
+void jobPoolSubmit(JobPool* pool, JobFn fn, void* arg){
+    mutexLock(&pool->lock);
+    while (pool->count == POOL_QUEUE_MAX) condWait(&pool->changed, &pool->lock);
+    pool->queue[(pool->head + pool->count) % POOL_QUEUE_MAX] = (Job){fn, arg};
+    pool->count++;
+    condBroadcast(&pool->changed);
+    mutexUnlock(&pool->lock);
+}
+
+// Versão que nunca espera: de dentro de um job, esperar vaga na fila pode travar
+// se todos os workers estiverem fazendo o mesmo.
+int jobPoolTrySubmit(JobPool* pool, JobFn fn, void* arg){
+    mutexLock(&pool->lock);
+    int ok = pool->count < POOL_QUEUE_MAX;
+    if (ok){
+        pool->queue[(pool->head + pool->count) % POOL_QUEUE_MAX] = (Job){fn, arg};
+        pool->count++;
+        condBroadcast(&pool->changed);
+    }
+    mutexUnlock(&pool->lock);
+    return ok;
+}
+
+// Jobs ainda na fila são descartados; os em execução terminam antes do join.
+void jobPoolStop(JobPool* pool){
+    mutexLock(&pool->lock);
+    pool->quit = 1;
+    condBroadcast(&pool->changed);
+    mutexUnlock(&pool->lock);
+    for (int i = 0; i < pool->threadCount; ++i) threadJoin(pool->threads[i]);
+    pool->threadCount = 0;
+}
+
+// --- Arquivos ---
+#ifdef _WIN32
+int mapFile(const char* path, MappedFile* out){
+    memset(out, 0, sizeof(*out));
+    HANDLE f = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (f == INVALID_HANDLE_VALUE) return 0;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(f, &size) || size.QuadPart == 0){ CloseHandle(f); return 0; }
+    HANDLE m = CreateFileMappingA(f, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!m){ CloseHandle(f); return 0; }
+    void* p = MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0);
+    if (!p){ CloseHandle(m); CloseHandle(f); return 0; }
+    out->data = (const unsigned char*)p; out->size = (size_t)size.QuadPart;
+    out->file = f; out->mapping = m;
+    return 1;
+}
+
+void unmapFile(MappedFile* mf){
+    if (mf->data){ UnmapViewOfFile(mf->data); CloseHandle(mf->mapping); CloseHandle(mf->file); }
+    memset(mf, 0, sizeof(*mf));
+}
+
+int replaceFile(const char* from, const char* to){
+    return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING) != 0;
+}
+
+int readFileAt(FILE* f, uint64_t offset, void* dst, size_t size){
+    if (_fseeki64(f, (__int64)offset, SEEK_SET) != 0) return 0;
+    return fread(dst, 1, size, f) == size;
+}
+
+int writeFileAt(FILE* f, uint64_t offset, const void* src, size_t size){
+    if (_fseeki64(f, (__int64)offset, SEEK_SET) != 0) return 0;
+    return fwrite(src, 1, size, f) == size;
+}
+
+static int makeDir(const char* path){ return CreateDirectoryA(path, NULL) || GetLastError() == ERROR_ALREADY_EXISTS; }
+
+void listFiles(const char* dir, void (*fn)(const char* path, void* ctx), void* ctx){
+    char pattern[300];
+    snprintf(pattern, sizeof(pattern), "%s/*", dir);
+    WIN32_FIND_DATAA fd;
+    HANDLE h = FindFirstFileA(pattern, &fd);
+    if (h == INVALID_HANDLE_VALUE) return;
+    do {
+        if (fd.cFileName[0] == '.') continue;
+        char path[300];
+        snprintf(path, sizeof(path), "%s/%s", dir, fd.cFileName);
+        if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) listFiles(path, fn, ctx);
+        else fn(path, ctx);
+    } while (FindNextFileA(h, &fd));
+    FindClose(h);
+}
+
+uint64_t fileWriteTime(const char* path){
+    WIN32_FILE_ATTRIBUTE_DATA fa;
+    if (!GetFileAttributesExA(path, GetFileExInfoStandard, &fa)) return 0;
+    return ((uint64_t)fa.ftLastWriteTime.dwHighDateTime << 32) | fa.ftLastWriteTime.dwLowDateTime;
+}
+#else
+int mapFile(const char* path, MappedFile* out){
+    memset(out, 0, sizeof(*out));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0){ close(fd); return 0; }
+    void* p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) return 0;
+    out->data = (const unsigned char*)p; out->size = (size_t)st.st_size;
+    return 1;
+}
+
+void unmapFile(MappedFile* mf){
+    if (mf->data) munmap((void*)mf->data, mf->size);
+    memset(mf, 0, sizeof(*mf));
+}
+
+int replaceFile(const char* from, const char* to){ return rename(from, to) == 0; }
+
+int readFileAt(FILE* f, uint64_t offset, void* dst, size_t size){
+    if (fseeko(f, (off_t)offset, SEEK_SET) != 0) return 0;
+    return fread(dst, 1, size, f) == size;
+}
+
+int writeFileAt(FILE* f, uint64_t offset, const void* src, size_t size){
+    if (fseeko(f, (off_t)offset, SEEK_SET) != 0) return 0;
+    return fwrite(src, 1, size, f) == size;
+}
+
+static int makeDir(const char* path){ return mkdir(path, 0755) == 0 || errno == EEXIST; }
+
+void listFiles(const char* dir, void (*fn)(const char* path, void* ctx), void* ctx){
+    DIR* d = opendir(dir);
+    if (!d) return;
+    struct dirent* e;
+    while ((e = readdir(d)) != NULL){
+        if (e->d_name[0] == '.') continue;
+        char path[300];
+        snprintf(path, sizeof(path), "%s/%s", dir, e->d_name);
+        struct stat st;
+        if (stat(path, &st) != 0) continue;
+        if (S_ISDIR(st.st_mode)) listFiles(path, fn, ctx);
+        else if (S_ISREG(st.st_mode)) fn(path, ctx);
+    }
+    closedir(d);
+}
+
+uint64_t fileWriteTime(const char* path){
+    struct stat st;
+    if (stat(path, &st) != 0) return 0;
+#if defined(__linux__)
+    return (uint64_t)st.st_mtim.tv_sec * 1000000000u + (uint64_t)st.st_mtim.tv_nsec;   // dois salvamentos no mesmo segundo
+#else
+    return (uint64_t)st.st_mtime;
+#endif
+}
+#endif
+
+// Cria todos os diretórios do caminho ("cache/texturas" -> "cache", "cache/texturas").
+int makeDirs(const char* path){
+    char buf[300];
+    snprintf(buf, sizeof(buf), "%s", path);
+    for (char* p = buf + 1; *p; ++p){
+        if (*p != '/' && *p != '\\') continue;
+        char c = *p; *p = '\0';
+        makeDir(buf);
+        *p = c;
+    }
+    return makeDir(buf);
+}
+
+uint64_t hashBytes(const void* data, size_t size, uint64_t seed){
+    const unsigned char* p = (const unsigned char*)data;
+    uint64_t h = seed;
+    for (size_t i = 0; i < size; ++i){ h ^= p[i]; h *= 0x100000001b3ull; }
+    return h;
+}
+
+// --- Tabela de recursos ---
+// Sondagem linear; remoção por deslocamento para trás (sem lápides), então a
+// tabela não degrada com cargas e descargas repetidas.
+static uint64_t resourceKey(uint64_t key){ return key ? key : 1; }
+
+void* resourceFind(const ResourceMap* map, uint64_t key){
+    if (!map->count) return NULL;
+    key = resourceKey(key);
+    uint32_t mask = map->capacity - 1;
+    for (uint32_t i = (uint32_t)(key ^ (key >> 32)) & mask; map->slots[i].key; i = (i + 1) & mask)
+        if (map->slots[i].key == key) return map->slots[i].value;
+    return NULL;
+}
+
+void resourceInsert(ResourceMap* map, uint64_t key, void* value){
+    if ((map->count + 1) * 4 > map->capacity * 3){   // carga máxima de 3/4
+        ResourceMap grown = {0};
+        grown.capacity = map->capacity ? map->capacity * 2 : 64;
+        grown.slots = (ResourceSlot*)calloc(grown.capacity, sizeof(ResourceSlot));
+        if (!grown.slots){ printf("Falha ao alocar a tabela de recursos\n"); return; }
+        for (uint32_t i = 0; i < map->capacity; ++i)
+            if (map->slots[i].key) resourceInsert(&grown, map->slots[i].key, map->slots[i].value);
+        free(map->slots);
+        *map = grown;
+    }
+    key = resourceKey(key);
+    uint32_t mask = map->capacity - 1, i = (uint32_t)(key ^ (key >> 32)) & mask;
+    for (; map->slots[i].key; i = (i + 1) & mask)
+        if (map->slots[i].key == key){ map->slots[i].value = value; return; }
+    map->slots[i].key = key;
+    map->slots[i].value = value;
+    map->count++;
+}
+
+void resourceRemove(ResourceMap* map, uint64_t key){
+    if (!map->count) return;
+    key = resourceKey(key);
+    uint32_t mask = map->capacity - 1, i = (uint32_t)(key ^ (key >> 32)) & mask;
+    for (; map->slots[i].key != key; i = (i + 1) & mask)
+        if (!map->slots[i].key) return;
+    // puxa para o buraco as entradas seguintes que não estão na posição de origem
+    for (uint32_t j = (i + 1) & mask; map->slots[j].key; j = (j + 1) & mask){
+        uint32_t home = (uint32_t)(map->slots[j].key ^ (map->slots[j].key >> 32)) & mask;
+        if (((j - home) & mask) >= ((j - i) & mask)){
+            map->slots[i] = map->slots[j];
+            i = j;
+        }
+    }
+    map->slots[i].key = 0;
+    map->slots[i].value = NULL;
+    map->count--;
+}
+
+void resourceRemoveValue(ResourceMap* map, const void* value){
+    for (uint32_t i = 0; i < map->capacity; ){   // a remoção pode puxar outra entrada para i
+        if (map->slots[i].key && map->slots[i].value == value) resourceRemove(map, map->slots[i].key);
+        else ++i;
+    }
+}
+
+// --- E/S assíncrona ---
+// Um único contexto por processo. io_uring: quem submete preenche a SQ sob ioLock e
+// uma thread colhe a CQ; threads: IO_THREADS threads fazem pread dos pedidos da fila.
+static IoBackend  ioBackend;
+static int        ioStarted, ioQuit;
+static Mutex      ioLock;
+static Cond       ioWake;                // fila de pendentes (threads) / vaga na CQ (io_uring)
+static IoRequest *ioPendingHead, *ioPendingTail;
+static Thread     ioThreads[IO_THREADS + 1];   // + a da CQ, se o io_uring cair para threads
+static int        ioThreadCount;
+
+static void ioComplete(IoRequest* r){
+    IoQueue* q = r->done;
+    r->next = NULL;
+    mutexLock(&q->lock);
+    if (q->tail) q->tail->next = r; else q->head = r;
+    q->tail = r;
+    condBroadcast(&q->ready);
+    mutexUnlock(&q->lock);
+}
+
+void ioQueueInit(IoQueue* q){
+    memset(q, 0, sizeof(*q));
+    mutexInit(&q->lock);
+    condInit(&q->ready);
+}
+
+IoRequest* ioQueuePop(IoQueue* q, int wait){
+    mutexLock(&q->lock);
+    while (wait && !q->head) condWait(&q->ready, &q->lock);
+    IoRequest* r = q->head;
+    if (r){
+        q->head = r->next;
+        if (!q->head) q->tail = NULL;
+    }
+    mutexUnlock(&q->lock);
+    return r;
+}
+
+#ifdef _WIN32
+void* ioAllocAligned(size_t size){ return _aligned_malloc(size, IO_ALIGN); }
+void  ioFreeAligned(void* p){ _aligned_free(p); }
+
+int ioOpen(const char* path, int direct, IoFile* out, uint64_t* size){
+    DWORD flags = FILE_ATTRIBUTE_NORMAL | (direct ? FILE_FLAG_NO_BUFFERING : 0);
+    HANDLE f = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, flags, NULL);
+    if (f == INVALID_HANDLE_VALUE) return 0;
+    LARGE_INTEGER sz;
+    if (size){
+        if (!GetFileSizeEx(f, &sz)){ CloseHandle(f); return 0; }
+        *size = (uint64_t)sz.QuadPart;
+    }
+    *out = f;
+    return direct ? 2 : 1;
+}
+
+void ioClose(IoFile f){ CloseHandle(f); }
+
+// Leitura posicional bloqueante (OVERLAPPED só carrega o offset num handle síncrono).
+static int32_t ioReadAt(IoRequest* r){
+    OVERLAPPED ov;
+    memset(&ov, 0, sizeof(ov));
+    ov.Offset = (DWORD)r->offset;
+    ov.OffsetHigh = (DWORD)(r->offset >> 32);
+    DWORD got = 0;
+    if (!ReadFile(r->file, r->dst, r->size, &got, &ov) && GetLastError() != ERROR_HANDLE_EOF) return -5;   // EIO
+    return (int32_t)got;
+}
+#else
+void* ioAllocAligned(size_t size){
+    void* p = NULL;
+    return posix_memalign(&p, IO_ALIGN, size) == 0 ? p : NULL;
+}
+void ioFreeAligned(void* p){ free(p); }
+
+int ioOpen(const char* path, int direct, IoFile* out, uint64_t* size){
+    int fd = -1, gotDirect = 0;
+#ifdef O_DIRECT
+    if (direct){
+        fd = open(path, O_RDONLY | O_DIRECT);   // tmpfs e alguns FS recusam: cai no buffered
+        gotDirect = fd >= 0;
+    }
+#endif
+    if (fd < 0) fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+    struct stat st;
+    if (size){
+        if (fstat(fd, &st) != 0){ close(fd); return 0; }
+        *size = (uint64_t)st.st_size;
+    }
+    *out = fd;
+    return gotDirect ? 2 : 1;
+}
+
+void ioClose(IoFile f){ close(f); }
+
+static int32_t ioReadAt(IoRequest* r){
+    uint32_t got = 0;
+    while (got < r->size){
+        ssize_t n = pread(r->file, (char*)r->dst + got, r->size - got, (off_t)(r->offset + got));
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return -errno;
+        if (n == 0) break;   // fim do arquivo
+        got += (uint32_t)n;
+        if (got & (IO_ALIGN - 1)) break;   // curta e desalinhada: é o fim (com O_DIRECT, repetir daria EINVAL)
+    }
+    return (int32_t)got;
+}
+#endif
+
+static void ioThreadMain(void* arg){
+    (void)arg;
+    for (;;){
+        mutexLock(&ioLock);
+        while (!ioPendingHead && !ioQuit) condWait(&ioWake, &ioLock);
+        if (ioQuit){ mutexUnlock(&ioLock); return; }
+        IoRequest* r = ioPendingHead;
+        ioPendingHead = r->next;
+        if (!ioPendingHead) ioPendingTail = NULL;
+        mutexUnlock(&ioLock);
+        r->result = ioReadAt(r);
+        ioComplete(r);
+    }
+}
+
+#ifdef USE_IO_URING
+// io_uring pelas syscalls (sem liburing): anéis mapeados, IORING_OP_READ (5.6+).
+static int                  ringFd = -1;
+static void                *ringSq, *ringCq;
+static size_t               ringSqSize, ringCqSize;
+static struct io_uring_sqe* ringSqes;
+static unsigned            *ringSqHead, *ringSqTail, *ringSqMask, *ringSqArray;
+static unsigned            *ringCqHead, *ringCqTail, *ringCqMask;
+static struct io_uring_cqe* ringCqes;
+static unsigned             ringSqEntries, ringCqEntries, ringInflight;   // em voo = já consumidos pelo kernel
+static IoRequest**          ringSlots;        // pedido de cada user_data em voo
+static unsigned*            ringFreeSlots;
+static unsigned             ringFreeCount;
+static int                  ringError;        // != 0 (-errno): anel inutilizado, pedidos novos vão para threads
+static struct io_uring_cqe* ringReaped;       // cópia da CQ colhida (a thread da CQ a libera antes do ioLock)
+#define RING_RETRY_MAX      1000              // EAGAIN/EBUSY seguidos (1 ms cada) antes de desistir do anel
+
+static int ringEnter(unsigned toSubmit, unsigned minComplete, unsigned flags){
+    return (int)syscall(__NR_io_uring_enter, ringFd, toSubmit, minComplete, flags, NULL, 0);
+}
+
+static int ringSetup(void){
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    ringFd = (int)syscall(__NR_io_uring_setup, IO_RING_ENTRIES, &p);
+    if (ringFd < 0) return 0;   // kernel antigo, seccomp, io_uring desativado
+    if (!(p.features & IORING_FEAT_RW_CUR_POS)){ close(ringFd); ringFd = -1; return 0; }   // sem IORING_OP_READ
+
+    ringSqSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    ringCqSize = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    int single = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single) ringSqSize = ringCqSize = ringSqSize > ringCqSize ? ringSqSize : ringCqSize;
+    ringSq = mmap(NULL, ringSqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+    ringCq = single ? ringSq : mmap(NULL, ringCqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+    ringSqes = (struct io_uring_sqe*)mmap(NULL, p.sq_entries * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE,
+                                          MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+    if (ringSq == MAP_FAILED || ringCq == MAP_FAILED || (void*)ringSqes == MAP_FAILED){
+        if (ringSq != MAP_FAILED) munmap(ringSq, ringSqSize);
+        if (!single && ringCq != MAP_FAILED) munmap(ringCq, ringCqSize);
+        if ((void*)ringSqes != MAP_FAILED) munmap(ringSqes, p.sq_entries * sizeof(struct io_uring_sqe));
+        close(ringFd); ringFd = -1;
+        return 0;
+    }
+    unsigned char* sq = (unsigned char*)ringSq;
+    unsigned char* cq = (unsigned char*)ringCq;
+    ringSqHead  = (unsigned*)(sq + p.sq_off.head);
+    ringSqTail  = (unsigned*)(sq + p.sq_off.tail);
+    ringSqMask  = (unsigned*)(sq + p.sq_off.ring_mask);
+    ringSqArray = (unsigned*)(sq + p.sq_off.array);
+    ringCqHead  = (unsigned*)(cq + p.cq_off.head);
+    ringCqTail  = (unsigned*)(cq + p.cq_off.tail);
+    ringCqMask  = (unsigned*)(cq + p.cq_off.ring_mask);
+    ringCqes    = (struct io_uring_cqe*)(cq + p.cq_off.cqes);
+    ringSqEntries = p.sq_entries;
+    ringCqEntries = p.cq_entries;
+    ringInflight = 0;
+    ringError = 0;
+    ringSlots = (IoRequest**)calloc(ringCqEntries, sizeof(IoRequest*));
+    ringFreeSlots = (unsigned*)malloc(ringCqEntries * sizeof(unsigned));
+    ringReaped = (struct io_uring_cqe*)malloc(ringCqEntries * sizeof(struct io_uring_cqe));
+    for (ringFreeCount = 0; ringFreeCount < ringCqEntries; ++ringFreeCount)
+        ringFreeSlots[ringFreeCount] = ringCqEntries - 1 - ringFreeCount;
+    return 1;
+}
+
+static void ringTeardown(void){
+    munmap(ringSqes, ringSqEntries * sizeof(struct io_uring_sqe));
+    if (ringCq != ringSq) munmap(ringCq, ringCqSize);
+    munmap(ringSq, ringSqSize);
+    close(ringFd);
+    ringFd = -1;
+    free(ringSlots);
+    free(ringFreeSlots);
+    free(ringReaped);
+    ringSlots = NULL;
+    ringFreeSlots = NULL;
+    ringReaped = NULL;
+}
+
+// Sob ioLock. Anel inutilizável: os pedidos em voo terminam com o erro (o kernel
+// não vai mais entregá-los) e, daqui em diante, ringSubmit passa tudo às threads.
+static void ringFail(int err){
+    if (ringError) return;
+    ringError = err;
+    printf("Aviso: io_uring falhou (%s); usando threads\n", strerror(-err));
+    for (unsigned i = 0; i < ringCqEntries; ++i){
+        if (!ringSlots[i]) continue;
+        ringSlots[i]->result = err;
+        ioComplete(ringSlots[i]);
+        ringSlots[i] = NULL;
+    }
+    ringInflight = 0;
+    condBroadcast(&ioWake);
+}
+
+// Sob ioLock. Escreve até 'count' SQEs, só nas posições que o kernel já consumiu, e
+// os entrega. Devolve quantos pedidos o kernel aceitou; os demais voltam da SQ.
+// EAGAIN/EBUSY (falta de memória no kernel, CQ cheia) esperam a thread da CQ colher
+// e tentam de novo; outro erro inutiliza o anel (ringFail).
+static int ringQueue(IoRequest** requests, int count){
+    unsigned tail = *ringSqTail;   // só quem segura ioLock escreve a cauda
+    unsigned space = ringSqEntries - (tail - __atomic_load_n(ringSqHead, __ATOMIC_ACQUIRE));
+    if ((unsigned)count > space) count = (int)space;
+    for (int i = 0; i < count; ++i){
+        IoRequest* r = requests[i];
+        unsigned slot = ringFreeSlots[--ringFreeCount];   // ringSubmit limita o total à CQ
+        ringSlots[slot] = r;
+        unsigned idx = (tail + (unsigned)i) & *ringSqMask;
+        struct io_uring_sqe* sqe = &ringSqes[idx];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = r->file;
+        sqe->off = r->offset;
+        sqe->addr = (uint64_t)(uintptr_t)r->dst;
+        sqe->len = r->size;
+        sqe->user_data = slot;
+        ringSqArray[idx] = idx;
+    }
+    __atomic_store_n(ringSqTail, tail + (unsigned)count, __ATOMIC_RELEASE);
+
+    int submitted = 0, retries = 0;
+    while (submitted < count){
+        int n = ringEnter((unsigned)(count - submitted), 0, 0);
+        if (n > 0){
+            submitted += n;
+            ringInflight += (unsigned)n;
+            retries = 0;
+            continue;
+        }
+        int err = n < 0 ? errno : EAGAIN;
+        if (err == EINTR) continue;
+        if ((err == EAGAIN || err == EBUSY) && ++retries <= RING_RETRY_MAX){
+            struct timespec pause = {0, 1000000};
+            nanosleep(&pause, NULL);   // a thread da CQ colhe sem precisar do ioLock
+            continue;
+        }
+        // Os SQEs não consumidos saem da SQ (o kernel só os lê dentro do enter)
+        __atomic_store_n(ringSqTail, tail + (unsigned)submitted, __ATOMIC_RELEASE);
+        for (int i = submitted; i < count; ++i){
+            unsigned slot = (unsigned)ringSqes[(tail + (unsigned)i) & *ringSqMask].user_data;
+            ringSlots[slot] = NULL;
+            ringFreeSlots[ringFreeCount++] = slot;
+        }
+        ringFail(-err);
+        break;
+    }
+    return submitted;
+}
+
+// Sob ioLock. Depois de uma falha do io_uring: fila das threads, criadas na primeira vez.
+static void ringFallback(IoRequest** requests, int count){
+    for (int i = 0; i < count; ++i){
+        IoRequest* r = requests[i];
+        r->next = NULL;
+        if (ioPendingTail) ioPendingTail->next = r; else ioPendingHead = r;
+        ioPendingTail = r;
+    }
+    while (ioThreadCount < IO_THREADS + 1) threadStart(&ioThreads[ioThreadCount++], ioThreadMain, NULL);
+    condBroadcast(&ioWake);
+}
+
+static void ringSubmit(IoRequest** requests, int count){
+    mutexLock(&ioLock);
+    while (count > 0 && !ringError){
+        int chunk = count < (int)ringSqEntries ? count : (int)ringSqEntries;
+        while (!ringError && ringInflight + (unsigned)chunk > ringCqEntries) condWait(&ioWake, &ioLock);   // CQ nunca transborda
+        if (ringError) break;
+        int queued = ringQueue(requests, chunk);
+        requests += queued;
+        count -= queued;
+        condBroadcast(&ioWake);   // acorda a thread da CQ, que espera algo em voo
+    }
+    if (count > 0) ringFallback(requests, count);
+    mutexUnlock(&ioLock);
+}
+
+// Só encerra sem nada em voo: quem espera um pedido sempre recebe uma resposta.
+static void ringReaperMain(void* arg){
+    (void)arg;
+    for (;;){
+        mutexLock(&ioLock);
+        while (ringInflight == 0 && !ioQuit && !ringError) condWait(&ioWake, &ioLock);
+        int done = ringInflight == 0 && (ioQuit || ringError);
+        mutexUnlock(&ioLock);
+        if (done) return;
+        if (ringEnter(0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY){
+            int err = -errno;
+            mutexLock(&ioLock);
+            ringFail(err);
+            mutexUnlock(&ioLock);
+            return;
+        }
+        // A CQ é esvaziada antes de pegar o ioLock: quem submete pode estar com ele,
+        // esperando justamente essa vaga (EBUSY).
+        unsigned head = *ringCqHead;
+        unsigned tail = __atomic_load_n(ringCqTail, __ATOMIC_ACQUIRE);
+        unsigned count = 0;
+        for (; head != tail; ++head) ringReaped[count++] = ringCqes[head & *ringCqMask];
+        __atomic_store_n(ringCqHead, head, __ATOMIC_RELEASE);
+        mutexLock(&ioLock);
+        for (unsigned i = 0; i < count; ++i){
+            unsigned slot = (unsigned)ringReaped[i].user_data;
+            IoRequest* r = ringSlots[slot];
+            if (!r) continue;   // já encerrado por ringFail
+            ringSlots[slot] = NULL;
+            ringFreeSlots[ringFreeCount++] = slot;
+            ringInflight--;
+            r->result = ringReaped[i].res;
+            ioComplete(r);
+        }
+        condBroadcast(&ioWake);
+        mutexUnlock(&ioLock);
+    }
+}
+#endif
+
+IoBackend ioStart(int allowUring){
+    mutexInit(&ioLock);
+    condInit(&ioWake);
+    ioQuit = 0;
+    ioPendingHead = ioPendingTail = NULL;
+    ioBackend = IO_BACKEND_THREADS;
+#ifdef USE_IO_URING
+    if (allowUring && ringSetup()){
+        ioBackend = IO_BACKEND_URING;
+        threadStart(&ioThreads[0], ringReaperMain, NULL);
+        ioThreadCount = 1;
+    }
+#else
+    (void)allowUring;
+#endif
+    if (ioBackend == IO_BACKEND_THREADS){
+        for (int i = 0; i < IO_THREADS; ++i) threadStart(&ioThreads[i], ioThreadMain, NULL);
+        ioThreadCount = IO_THREADS;
+    }
+    ioStarted = 1;
+    return ioBackend;
+}
+
+void ioSubmit(IoRequest** requests, int count){
+#ifdef USE_IO_URING
+    if (ioBackend == IO_BACKEND_URING){ ringSubmit(requests, count); return; }
+#endif
+    mutexLock(&ioLock);
+    for (int i = 0; i < count; ++i){
+        IoRequest* r = requests[i];
+        r->next = NULL;
+        if (ioPendingTail) ioPendingTail->next = r; else ioPendingHead = r;
+        ioPendingTail = r;
+    }
+    condBroadcast(&ioWake);
+    mutexUnlock(&ioLock);
+}
+
+// Espera as leituras já enviadas ao kernel; pedidos ainda na fila das threads são descartados.
+void ioStop(void){
+    if (!ioStarted) return;
+    mutexLock(&ioLock);
+    ioQuit = 1;
+    condBroadcast(&ioWake);   // a thread da CQ sai quando não há mais nada em voo
+    mutexUnlock(&ioLock);
+    for (int i = 0; i < ioThreadCount; ++i) threadJoin(ioThreads[i]);
+    ioThreadCount = 0;
+#ifdef USE_IO_URING
+    if (ioBackend == IO_BACKEND_URING) ringTeardown();
+#endif
+    mutexDestroy(&ioLock);
+    ioStarted = 0;
+}
+
+// --- Pacote de assets ---
+// assets.pak junta tudo de assets/ num arquivo só, mapeado uma vez na partida:
+// cabeçalho, diretório ordenado pelo hash do nome e os dados, cada entrada
+// alinhada conforme o tipo (texturas em página, para só as páginas usadas serem
+// lidas do disco). Os loaders recebem ponteiros direto no mapeamento. Se o pacote
+// não existir, openAsset cai para o arquivo solto; se existir, ele tem prioridade
+// (gere de novo com --pack depois de mudar algo em assets/).
+#define PACK_MAGIC   0x314b4150u   // "PAK1"
+#define PACK_VERSION 2u
+#define PACK_DIR     "assets"
+
+typedef enum { PACK_RAW, PACK_SHADER, PACK_TEXTURE, PACK_MESH } PackType;
+
+typedef struct { uint32_t magic, version, count, reserved; } PackHeader;
+
+typedef struct {
+    uint64_t nameHash;   // hashBytes do caminho com '/' (ex.: "assets/textures/sol.jpg")
+    uint64_t offset, size;
+    uint32_t type, alignment;
+    uint64_t contentHash;   // hashBytes dos dados (deduplicação sem ler o arquivo)
+} PackEntry;
+
+static MappedFile       assetPack;
+static const PackEntry* packEntries;
+static uint32_t         packCount;
+
+static uint64_t hashAssetName(const char* name){
+    char buf[300];
+    size_t n = 0;
+    for (; name[n] && n + 1 < sizeof(buf); ++n) buf[n] = name[n] == '\\' ? '/' : name[n];
+    return hashBytes(buf, n, HASH_SEED);
+}
+
+int openAssetPack(const char* path){
+    if (!mapFile(path, &assetPack)) return 0;
+    const PackHeader* hdr = (const PackHeader*)assetPack.data;
+    if (assetPack.size < sizeof(PackHeader) || hdr->magic != PACK_MAGIC || hdr->version != PACK_VERSION
+        || sizeof(PackHeader) + (uint64_t)hdr->count * sizeof(PackEntry) > assetPack.size){
+        printf("Aviso: pacote de assets invalido: %s\n", path);
+        unmapFile(&assetPack);
+        return 0;
+    }
+    packEntries = (const PackEntry*)(assetPack.data + sizeof(PackHeader));
+    packCount = hdr->count;
+    printf("Pacote de assets: %s (%u entradas)\n", path, packCount);
+    return 1;
+}
+
+static const PackEntry* findPackEntry(const char* name){
+    if (!packCount) return NULL;
+    uint64_t h = hashAssetName(name);
+    uint32_t lo = 0, hi = packCount;
+    while (lo < hi){
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (packEntries[mid].nameHash < h) lo = mid + 1; else hi = mid;
+    }
+    if (lo < packCount && packEntries[lo].nameHash == h && packEntries[lo].offset + packEntries[lo].size <= assetPack.size)
+        return &packEntries[lo];
+    return NULL;
+}
+
+int openAsset(const char* name, AssetView* out){
+    memset(out, 0, sizeof(*out));
+    const PackEntry* e = findPackEntry(name);
+    if (e){
+        out->data = assetPack.data + e->offset;
+        out->size = (size_t)e->size;
+        return 1;
+    }
+    if (!mapFile(name, &out->map)) return 0;
+    out->data = out->map.data;
+    out->size = out->map.size;
+    return 1;
+}
+
+// Hash do conteúdo de um asset, quando já vem pronto no pacote. Arquivos soltos não
+// são lidos aqui: quem precisa do hash deles o calcula com o arquivo já aberto.
+int assetContentHash(const char* name, uint64_t* out){
+    const PackEntry* e = findPackEntry(name);
+    if (!e) return 0;
+    *out = e->contentHash;
+    return 1;
+}
+
+void closeAsset(AssetView* a){
+    unmapFile(&a->map);   // nada a fazer quando aponta para o pacote
+    free(a->owned);
+    memset(a, 0, sizeof(*a));
+}
+
+typedef struct {
+    char**  names;
+    int     count, capacity;
+} PackList;
+
+static void collectPackFile(const char* path, void* ctx){
+    PackList* list = (PackList*)ctx;
+    if (list->count == list->capacity){
+        list->capacity = list->capacity ? list->capacity * 2 : 64;
+        list->names = (char**)realloc(list->names, (size_t)list->capacity * sizeof(char*));
+    }
+    size_t len = strlen(path);
+    char* name = (char*)malloc(len + 1);
+    for (size_t i = 0; i <= len; ++i) name[i] = path[i] == '\\' ? '/' : path[i];
+    list->names[list->count++] = name;
+}
+
+static PackType packTypeFor(const char* name){
+    const char* ext = strrchr(name, '.');
+    if (!ext) return PACK_RAW;
+    if (strcmp(ext, ".glsl") == 0 || strcmp(ext, ".vert") == 0 || strcmp(ext, ".frag") == 0) return PACK_SHADER;
+    if (strcmp(ext, ".jpg") == 0 || strcmp(ext, ".jpeg") == 0 || strcmp(ext, ".png") == 0
+        || strcmp(ext, ".tga") == 0 || strcmp(ext, ".bmp") == 0) return PACK_TEXTURE;
+    if (strcmp(ext, ".obj") == 0 || strcmp(ext, ".mesh") == 0) return PACK_MESH;
+    return PACK_RAW;
+}
+
+static int comparePackEntry(const void* a, const void* b){
+    uint64_t x = ((const PackEntry*)a)->nameHash, y = ((const PackEntry*)b)->nameHash;
+    return x < y ? -1 : (x > y);
+}
+
+// Empacotador (--pack): tudo que há em assets/ vai para 'outPath'.
+int buildAssetPack(const char* outPath){
+    PackList list = {0};
+    listFiles(PACK_DIR, collectPackFile, &list);
+    if (list.count == 0){ printf("Nenhum arquivo em %s/\n", PACK_DIR); return 1; }
+
+    PackEntry* entries = (PackEntry*)calloc((size_t)list.count, sizeof(PackEntry));
+    int* order = (int*)malloc((size_t)list.count * sizeof(int));   // entrada -> nome
+    for (int i = 0; i < list.count; ++i){
+        entries[i].nameHash = hashAssetName(list.names[i]);
+        entries[i].type = (uint32_t)packTypeFor(list.names[i]);
+        entries[i].alignment = entries[i].type == PACK_TEXTURE ? 4096u : 16u;
+        entries[i].offset = (uint64_t)i;   // provisório: índice do nome
+    }
+    qsort(entries, (size_t)list.count, sizeof(PackEntry), comparePackEntry);
+    int ok = 1;
+    for (int i = 0; i < list.count; ++i){
+        order[i] = (int)entries[i].offset;
+        if (i > 0 && entries[i].nameHash == entries[i - 1].nameHash){
+            printf("Colisao de hash no pacote: %s / %s\n", list.names[order[i]], list.names[order[i - 1]]);
+            ok = 0;
+        }
+    }
+
+    char tmp[320];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", outPath);
+    FILE* f = ok ? fopen(tmp, "wb") : NULL;
+    PackHeader hdr = {PACK_MAGIC, PACK_VERSION, (uint32_t)list.count, 0};
+    uint64_t offset = sizeof(hdr) + (uint64_t)list.count * sizeof(PackEntry);
+    ok = f && fwrite(&hdr, sizeof(hdr), 1, f) == 1
+           && fseek(f, (long)offset, SEEK_SET) == 0;   // o diretório é gravado no fim, com os offsets
+    uint64_t total = 0;
+    for (int i = 0; ok && i < list.count; ++i){
+        MappedFile mf;
+        const char* name = list.names[order[i]];
+        if (!mapFile(name, &mf)){ printf("Falha ao ler %s\n", name); ok = 0; break; }
+        uint64_t aligned = (offset + entries[i].alignment - 1) & ~(uint64_t)(entries[i].alignment - 1);
+        static const unsigned char zeros[4096];
+        ok = fwrite(zeros, 1, (size_t)(aligned - offset), f) == (size_t)(aligned - offset)
+          && fwrite(mf.data, 1, mf.size, f) == mf.size;
+        entries[i].offset = aligned;
+        entries[i].size = mf.size;
+        entries[i].contentHash = hashBytes(mf.data, mf.size, HASH_SEED);
+        offset = aligned + mf.size;
+        total += mf.size;
+        printf("  %-44s %10zu bytes\n", name, mf.size);
+        unmapFile(&mf);
+    }
+    ok = ok && fseek(f, (long)sizeof(hdr), SEEK_SET) == 0
+            && fwrite(entries, sizeof(PackEntry), (size_t)list.count, f) == (size_t)list.count;
+    if (f) ok = (fclose(f) == 0) && ok;
+    if (ok) ok = replaceFile(tmp, outPath);
+    if (!ok){ remove(tmp); printf("Falha ao gravar %s\n", outPath); }
+    else printf("%s: %d arquivos, %.1f MB\n", outPath, list.count, total / (1024.0 * 1024.0));
+
+    for (int i = 0; i < list.count; ++i) free(list.names[i]);
+    free(list.names);
+    free(entries);
+    free(order);
+    return ok ? 0 : 1;
+}
+
+int packAssets(void){ return buildAssetPack(PACK_FILE); }
+
+typedef struct {
+    RangeFn fn;
+    void*   ctx;
+    int     count, grain, next;
+    int     active;   // faixas em execução
+    int     refs;     // quem chama + jobs auxiliares ainda não encerrados
+    Mutex   lock;
+    Cond    done;
+} ParallelFor;
+
+static void releaseParallelFor(ParallelFor* pf){
+    mutexLock(&pf->lock);
+    int refs = --pf->refs;
+    mutexUnlock(&pf->lock);
+    if (refs == 0){ mutexDestroy(&pf->lock); free(pf); }
+}
+
+static void runParallelRanges(ParallelFor* pf){
+    for (;;){
+        mutexLock(&pf->lock);
+        if (pf->next >= pf->count){ mutexUnlock(&pf->lock); return; }
+        int begin = pf->next;
+        int end = begin + pf->grain < pf->count ? begin + pf->grain : pf->count;
+        pf->next = end;
+        pf->active++;
+        mutexUnlock(&pf->lock);
+
+        pf->fn(pf->ctx, begin, end);
+
+        mutexLock(&pf->lock);
+        if (--pf->active == 0 && pf->next >= pf->count) condBroadcast(&pf->done);
+        mutexUnlock(&pf->lock);
+    }
+}
+
+static void parallelForHelper(void* arg){
+    ParallelFor* pf = (ParallelFor*)arg;
+    runParallelRanges(pf);
+    releaseParallelFor(pf);
+}
+
+void parallelFor(JobPool* pool, int count, int grain, RangeFn fn, void* ctx){
+    if (count <= 0) return;
+    if (grain < 1) grain = 1;
+    int helpers = (count + grain - 1) / grain - 1;
+    if (!pool || pool->threadCount == 0 || helpers <= 0){ fn(ctx, 0, count); return; }
+    if (helpers > pool->threadCount) helpers = pool->threadCount;
+
+    // No heap: auxiliares que só rodarem depois do fim ainda acessam o estado.
+    ParallelFor* pf = (ParallelFor*)calloc(1, sizeof(ParallelFor));
+    pf->fn = fn; pf->ctx = ctx; pf->count = count; pf->grain = grain;
+    pf->refs = 1 + helpers;
+    mutexInit(&pf->lock);
+    condInit(&pf->done);
+    // Auxiliares só entram se houver vaga: parallelFor roda dentro de jobs, e
+    // esperar a fila esvaziar aqui travaria com todos os workers no mesmo ponto.
+    // As faixas de quem não entrou ficam para quem chama.
+    int submitted = 0;
+    while (submitted < helpers && jobPoolTrySubmit(pool, parallelForHelper, pf)) submitted++;
+    if (submitted < helpers){
+        mutexLock(&pf->lock);
+        pf->refs -= helpers - submitted;   // quem chama ainda segura uma referência
+        mutexUnlock(&pf->lock);
+    }
+
+    runParallelRanges(pf);
+    mutexLock(&pf->lock);
+    while (pf->active > 0) condWait(&pf->done, &pf->lock);
+    mutexUnlock(&pf->lock);
+    releaseParallelFor(pf);
+}
+
+// --- Arena de decodificação (stb_image) ---
+// Cada thread guarda um bloco que é reaproveitado entre decodificações: entre
+// decodeArenaBegin/End tudo que o stb_image pede sai dele em ordem (free só
+// devolve a última alocação) e decodeArenaEnd zera o bloco de uma vez. Fora desse
+// intervalo as funções caem no malloc comum. Cada alocação leva um cabeçalho com
+// o tamanho e a origem, então stbi_image_free funciona nos dois casos.
+#define ARENA_CHUNK_MIN  (1u << 20)
+#define ARENA_RETAIN_MAX (64u << 20)   // acima disso o bloco volta ao sistema
+
+typedef struct ArenaChunk {
+    struct ArenaChunk* prev;
+    size_t size, used;
+    size_t reserved;                    // mantém os dados alinhados em 16 bytes
+} ArenaChunk;
+
+typedef struct { size_t size; size_t fromArena; } ArenaHeader;
+
+typedef struct {
+    ArenaChunk* chunk;
+    int    active;
+    size_t used, peak;
+    void*  last;                        // última alocação (pode crescer/voltar no lugar)
+} DecodeArena;
+
+static THREAD_LOCAL DecodeArena decodeArena;
+
+static size_t arenaFootprint(size_t size){ return sizeof(ArenaHeader) + ((size + 15) & ~(size_t)15); }
+
+void* decodeAlloc(size_t size){
+    DecodeArena* a = &decodeArena;
+    ArenaHeader* h;
+    if (!a->active){
+        h = (ArenaHeader*)malloc(sizeof(ArenaHeader) + size);
+        if (!h) return NULL;
+        h->size = size;
+        h->fromArena = 0;
+        return h + 1;
+    }
+    size_t need = arenaFootprint(size);
+    ArenaChunk* c = a->chunk;
+    if (!c || c->used + need > c->size){
+        size_t cap = c ? c->size * 2 : ARENA_CHUNK_MIN;
+        while (cap < need) cap *= 2;
+        ArenaChunk* nc = (ArenaChunk*)malloc(sizeof(ArenaChunk) + cap);
+        if (!nc) return NULL;
+        nc->prev = c;
+        nc->size = cap;
+        nc->used = 0;
+        a->chunk = c = nc;
+    }
+    h = (ArenaHeader*)((unsigned char*)(c + 1) + c->used);
+    h->size = size;
+    h->fromArena = 1;
+    c->used += need;
+    a->used += need;
+    if (a->used > a->peak) a->peak = a->used;
+    a->last = h + 1;
+    return h + 1;
+}
+
+void decodeFree(void* p){
+    if (!p) return;
+    ArenaHeader* h = (ArenaHeader*)p - 1;
+    if (!h->fromArena){ free(h); return; }
+    DecodeArena* a = &decodeArena;
+    if (p == a->last){
+        size_t need = arenaFootprint(h->size);
+        a->chunk->used -= need;
+        a->used -= need;
+        a->last = NULL;
+    }
+}
+
+void* decodeRealloc(void* p, size_t size){
+    if (!p) return decodeAlloc(size);
+    ArenaHeader* h = (ArenaHeader*)p - 1;
+    if (!h->fromArena){
+        ArenaHeader* nh = (ArenaHeader*)realloc(h, sizeof(ArenaHeader) + size);
+        if (!nh) return NULL;
+        nh->size = size;
+        return nh + 1;
+    }
+    DecodeArena* a = &decodeArena;
+    if (p == a->last){   // zlib cresce a saída várias vezes: estende no lugar quando cabe
+        ArenaChunk* c = a->chunk;
+        size_t oldNeed = arenaFootprint(h->size), newNeed = arenaFootprint(size);
+        if (c->used - oldNeed + newNeed <= c->size){
+            c->used = c->used - oldNeed + newNeed;
+            a->used = a->used - oldNeed + newNeed;
+            if (a->used > a->peak) a->peak = a->used;
+            h->size = size;
+            return p;
+        }
+    }
+    void* np = decodeAlloc(size);
+    if (!np) return NULL;
+    memcpy(np, p, h->size < size ? h->size : size);
+    decodeFree(p);
+    return np;
+}
+
+void decodeArenaBegin(void){
+    DecodeArena* a = &decodeArena;
+    a->active = 1;
+    a->used = a->peak = 0;
+    a->last = NULL;
+}
+
+// Encerra a decodificação da thread: os ponteiros devolvidos pelo stb_image deixam
+// de valer. Se a arena precisou de vários blocos, eles viram um só do tamanho do
+// pico, para a próxima imagem parecida caber sem novas alocações.
+size_t decodeArenaEnd(void){
+    DecodeArena* a = &decodeArena;
+    size_t keep = (a->peak + ARENA_CHUNK_MIN - 1) & ~(size_t)(ARENA_CHUNK_MIN - 1);
+    if (a->chunk && (a->chunk->prev || a->chunk->size > ARENA_RETAIN_MAX)){
+        while (a->chunk){ ArenaChunk* prev = a->chunk->prev; free(a->chunk); a->chunk = prev; }
+        if (keep <= ARENA_RETAIN_MAX){
+            a->chunk = (ArenaChunk*)malloc(sizeof(ArenaChunk) + keep);
+            if (a->chunk){ a->chunk->prev = NULL; a->chunk->size = keep; }
+        }
+    }
+    if (a->chunk) a->chunk->used = 0;
+    a->active = 0;
+    a->used = 0;
+    a->last = NULL;
+    return a->peak;
+}
+
+// --- JPEG baseline em paralelo (restart markers) ---
+// Com DRI, cada intervalo de restart recomeça o preditor DC e o leitor de bits num
+// byte alinhado, então os intervalos são independentes. Tudo reusa o próprio
+// stb_image (cabeçalho, Huffman, IDCT, reamostragem, YCbCr->RGB), só muda a ordem:
+//  1. os segmentos entre RSTn saem em paralelo (entropia + IDCT), cada um com uma
+//     cópia do stbi__jpeg e um stbi__context só dele, escrevendo em blocos disjuntos;
+//  2. reamostragem dos cromas e conversão de cor em faixas de linhas; cada faixa
+//     reconstrói o stbi__resample da sua primeira linha.
+// O resultado é byte a byte o de stbi_load_from_memory. Progressivo, sem DRI, scans
+// não intercalados, RGB/CMYK e arquivos cujos RSTn não fecham a conta vão para o stb.
+#define JPEG_MIN_SEGMENTS 4    // abaixo disso o paralelismo não compensa
+#define JPEG_ROWS_GRAIN   64
+
+typedef struct {
+    stbi__jpeg*           z;
+    const unsigned char** segments;   // início de cada intervalo (após o SOS ou um RSTn)
+    const unsigned char*  scanEnd;
+    int                   units;      // MCUs (ou blocos, com um componente)
+    int                   failed;
+} JpegScanJob;
+
+typedef struct {
+    stbi__jpeg*    z;
+    unsigned char* out;
+    int            n;
+    int            failed;
+} JpegColorJob;
+
+// Marca o início de cada intervalo; -1 se houver mais RSTn que o esperado.
+static int findRestartSegments(const unsigned char* p, const unsigned char* end, const unsigned char** segments,
+                               int maxSegments, const unsigned char** scanEnd){
+    int count = 0;
+    segments[count++] = p;
+    while (p + 1 < end){
+        if (p[0] != 0xFF){ p++; continue; }
+        unsigned char m = p[1];
+        if (m == 0x00){ p += 2; continue; }   // 0xFF dos dados
+        if (m == 0xFF){ p += 1; continue; }   // preenchimento
+        if (m < 0xD0 || m > 0xD7) break;      // outro marcador: fim do scan
+        if (count == maxSegments) return -1;
+        p += 2;
+        segments[count++] = p;
+    }
+    *scanEnd = p;
+    return count;
+}
+
+static void jpegScanSegments(void* ctx, int begin, int end){
+    JpegScanJob* job = (JpegScanJob*)ctx;
+    stbi__jpeg* z = (stbi__jpeg*)malloc(sizeof(stbi__jpeg));   // ~20 KB de tabelas: fora da pilha
+    if (!z){ job->failed = 1; return; }
+    *z = *job->z;
+    stbi__context s;
+    STBI_SIMD_ALIGN(short, data[64]);
+    int bad = 0;
+    for (int seg = begin; seg < end && !bad; ++seg){
+        stbi__start_mem(&s, job->segments[seg], (int)(job->scanEnd - job->segments[seg]));
+        z->s = &s;
+        stbi__jpeg_reset(z);
+        int first = seg * z->restart_interval;
+        int last = first + z->restart_interval < job->units ? first + z->restart_interval : job->units;
+        for (int u = first; u < last && !bad; ++u){
+            if (z->scan_n == 1){   // um bloco por unidade, em ordem de varredura
+                int n = z->order[0], ha = z->img_comp[n].ha;
+                int bw = (z->img_comp[n].x + 7) >> 3;
+                int bx = u % bw, by = u / bw;
+                bad = !stbi__jpeg_decode_block(z, data, z->huff_dc + z->img_comp[n].hd, z->huff_ac + ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq]);
+                if (!bad) z->idct_block_kernel(z->img_comp[n].data + z->img_comp[n].w2 * by * 8 + bx * 8, z->img_comp[n].w2, data);
+                continue;
+            }
+            int mx = u % z->img_mcu_x, my = u / z->img_mcu_x;
+            for (int k = 0; k < z->scan_n && !bad; ++k){
+                int n = z->order[k], ha = z->img_comp[n].ha;
+                for (int y = 0; y < z->img_comp[n].v && !bad; ++y){
+                    for (int x = 0; x < z->img_comp[n].h && !bad; ++x){
+                        int x2 = (mx * z->img_comp[n].h + x) * 8;
+                        int y2 = (my * z->img_comp[n].v + y) * 8;
+                        bad = !stbi__jpeg_decode_block(z, data, z->huff_dc + z->img_comp[n].hd, z->huff_ac + ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq]);
+                        if (!bad) z->idct_block_kernel(z->img_comp[n].data + z->img_comp[n].w2 * y2 + x2, z->img_comp[n].w2, data);
+                    }
+                }
+            }
+        }
+    }
+    if (bad) job->failed = 1;
+    free(z);
+}
+
+// Mesmo avanço de linha do laço de load_jpeg_image.
+static void jpegResampleStep(stbi__resample* r, const stbi__jpeg* z, int k){
+    if (++r->ystep >= r->vs){
+        r->ystep = 0;
+        r->line0 = r->line1;
+        if (++r->ypos < z->img_comp[k].y) r->line1 += z->img_comp[k].w2;
+    }
+}
+
+static void jpegColorRows(void* ctx, int begin, int end){
+    JpegColorJob* job = (JpegColorJob*)ctx;
+    stbi__jpeg* z = job->z;
+    int imgN = z->s->img_n, w = (int)z->s->img_x;
+    stbi__resample res[4];
+    unsigned char* linebuf[4] = {NULL, NULL, NULL, NULL};
+    stbi_uc* coutput[4];
+    for (int k = 0; k < imgN; ++k){
+        stbi__resample* r = &res[k];
+        linebuf[k] = (unsigned char*)malloc((size_t)w + 3);
+        r->hs      = z->img_h_max / z->img_comp[k].h;
+        r->vs      = z->img_v_max / z->img_comp[k].v;
+        r->ystep   = r->vs >> 1;
+        r->w_lores = (w + r->hs - 1) / r->hs;
+        r->ypos    = 0;
+        r->line0   = r->line1 = z->img_comp[k].data;
+        if      (r->hs == 1 && r->vs == 1) r->resample = resample_row_1;
+        else if (r->hs == 1 && r->vs == 2) r->resample = stbi__resample_row_v_2;
+        else if (r->hs == 2 && r->vs == 1) r->resample = stbi__resample_row_h_2;
+        else if (r->hs == 2 && r->vs == 2) r->resample = z->resample_row_hv_2_kernel;
+        else                               r->resample = stbi__resample_row_generic;
+        for (int j = 0; j < begin; ++j) jpegResampleStep(r, z, k);
+    }
+    // O conversor do stb grava 1 byte além de cada pixel; a última linha da faixa
+    // passaria para a primeira da faixa seguinte, então sai num buffer à parte.
+    unsigned char* lastRow = (unsigned char*)malloc((size_t)job->n * w + 1);
+    int ready = lastRow != NULL;
+    for (int k = 0; k < imgN; ++k) ready = ready && linebuf[k];
+
+    for (int j = begin; ready && j < end; ++j){
+        unsigned char* row = job->out + (size_t)job->n * w * j;
+        unsigned char* out = j == end - 1 ? lastRow : row;
+        for (int k = 0; k < imgN; ++k){
+            stbi__resample* r = &res[k];
+            int yBot = r->ystep >= (r->vs >> 1);
+            coutput[k] = r->resample(linebuf[k], yBot ? r->line1 : r->line0, yBot ? r->line0 : r->line1, r->w_lores, r->hs);
+            jpegResampleStep(r, z, k);
+        }
+        if (imgN == 3) z->YCbCr_to_RGB_kernel(out, coutput[0], coutput[1], coutput[2], w, job->n);
+        else memcpy(out, coutput[0], (size_t)w);
+        if (out != row) memcpy(row, out, (size_t)job->n * w);
+    }
+    if (!ready) job->failed = 1;
+    free(lastRow);
+    for (int k = 0; k < imgN; ++k) free(linebuf[k]);
+}
+
+// NULL quando o arquivo não serve para o caminho paralelo (ou falhou): use o stb.
+static unsigned char* decodeJpegParallel(const unsigned char* data, size_t size, int* outW, int* outH, int* outN){
+    if (size < 4 || size > 0x7fffffff || data[0] != 0xFF || data[1] != 0xD8) return NULL;
+    stbi__context s;
+    stbi__start_mem(&s, data, (int)size);
+    stbi__jpeg* z = (stbi__jpeg*)stbi__malloc(sizeof(stbi__jpeg));
+    if (!z) return NULL;
+    memset(z, 0, sizeof(*z));
+    z->s = &s;
+    stbi__setup_jpeg(z);
+    s.img_n = 0;   // stbi__cleanup_jpeg seguro mesmo sem cabeçalho
+
+    // Marcadores até o SOS, como em stbi__decode_jpeg_image
+    int ok = stbi__decode_jpeg_header(z, STBI__SCAN_load);
+    int m = ok ? stbi__get_marker(z) : 0;
+    while (ok && !stbi__SOS(m)){
+        if (stbi__EOI(m) || stbi__DNL(m) || !stbi__process_marker(z, m)) ok = 0;
+        else m = stbi__get_marker(z);
+    }
+    ok = ok && stbi__process_scan_header(z);
+    int imgN = s.img_n;
+    int isRgb = imgN == 3 && (z->rgb == 3 || (z->app14_color_transform == 0 && !z->jfif));
+    ok = ok && !z->progressive && z->restart_interval > 0 && z->scan_n == imgN && (imgN == 1 || (imgN == 3 && !isRgb));
+
+    const unsigned char** segments = NULL;
+    unsigned char* out = NULL;
+    if (ok){
+        int units = imgN == 1 ? ((z->img_comp[z->order[0]].x + 7) >> 3) * ((z->img_comp[z->order[0]].y + 7) >> 3)
+                              : z->img_mcu_x * z->img_mcu_y;
+        int expected = (units + z->restart_interval - 1) / z->restart_interval;
+        const unsigned char* scanEnd = NULL;
+        segments = (const unsigned char**)malloc((size_t)expected * sizeof(*segments));
+        ok = segments && expected >= JPEG_MIN_SEGMENTS
+          && findRestartSegments(s.img_buffer, s.img_buffer_end, segments, expected, &scanEnd) == expected;
+        if (ok){
+            JpegScanJob scan = {z, segments, scanEnd, units, 0};
+            parallelFor(&workers, expected, expected / (4 * (workers.threadCount + 1)) + 1, jpegScanSegments, &scan);
+            ok = !scan.failed;
+        }
+    }
+    if (ok){
+        out = (unsigned char*)stbi__malloc_mad3(imgN, (int)s.img_x, (int)s.img_y, 1);
+        if (out){
+            JpegColorJob color = {z, out, imgN, 0};
+            parallelFor(&workers, (int)s.img_y, JPEG_ROWS_GRAIN, jpegColorRows, &color);
+            if (color.failed){ STBI_FREE(out); out = NULL; }
+        }
+        if (out){
+            *outW = (int)s.img_x;
+            *outH = (int)s.img_y;
+            *outN = imgN;
+            if (stbi__vertically_flip_on_load) stbi__vertical_flip(out, *outW, *outH, imgN);
+        }
+    }
+    stbi__cleanup_jpeg(z);
+    STBI_FREE(z);
+    free(segments);
+    return out;
+}
+
+// --- Decodificadores de imagem (backends) ---
+// decodeImage tenta, em ordem, os backends que aceitam o arquivo; o stb aceita tudo
+// e fecha a lista. libjpeg(-turbo) e libpng entram só se compilados com USE_LIBJPEG
+// (-ljpeg) / USE_LIBPNG (-lpng). --decoder=<nome> põe um backend na frente dos demais.
+// Todo backend devolve pixels 8 bits em linhas de cima para baixo (ou de baixo para
+// cima com stbi_set_flip_vertically_on_load), alocados com STBI_MALLOC: o chamador
+// libera sempre com stbi_image_free.
+static int isJpeg(const unsigned char* d, size_t size){ return size > 3 && d[0] == 0xFF && d[1] == 0xD8 && d[2] == 0xFF; }
+static int anyImage(const unsigned char* d, size_t size){ (void)d; return size > 0 && size <= 0x7fffffff; }
+
+static unsigned char* decodeStb(const unsigned char* data, size_t size, int* w, int* h, int* n){
+    return stbi_load_from_memory(data, (int)size, w, h, n, 0);
+}
+
+#ifdef USE_LIBJPEG
+typedef struct { struct jpeg_error_mgr pub; jmp_buf env; } LibjpegError;
+
+static void libjpegErrorExit(j_common_ptr cinfo){ longjmp(((LibjpegError*)cinfo->err)->env, 1); }
+static void libjpegSilence(j_common_ptr cinfo){ (void)cinfo; }   // avisos de arquivo corrompido ficam com o stb
+
+static unsigned char* decodeLibjpeg(const unsigned char* data, size_t size, int* w, int* h, int* n){
+    struct jpeg_decompress_struct cinfo;
+    LibjpegError err;
+    unsigned char* volatile out = NULL;
+    cinfo.err = jpeg_std_error(&err.pub);
+    err.pub.error_exit = libjpegErrorExit;
+    err.pub.output_message = libjpegSilence;
+    if (setjmp(err.env)){
+        jpeg_destroy_decompress(&cinfo);
+        if (out) STBI_FREE(out);
+        return NULL;   // cai no próximo backend
+    }
+    jpeg_create_decompress(&cinfo);
+    jpeg_mem_src(&cinfo, (unsigned char*)data, (unsigned long)size);
+    jpeg_read_header(&cinfo, TRUE);
+    if (cinfo.jpeg_color_space == JCS_CMYK || cinfo.jpeg_color_space == JCS_YCCK){ jpeg_destroy_decompress(&cinfo); return NULL; }
+    cinfo.out_color_space = cinfo.num_components == 1 ? JCS_GRAYSCALE : JCS_RGB;
+    jpeg_start_decompress(&cinfo);
+    int channels = cinfo.output_components;
+    size_t stride = (size_t)cinfo.output_width * channels;
+    out = (unsigned char*)STBI_MALLOC(stride * cinfo.output_height);
+    if (!out) longjmp(err.env, 1);
+    int flip = stbi__vertically_flip_on_load;
+    while (cinfo.output_scanline < cinfo.output_height){
+        JDIMENSION y = cinfo.output_scanline;
+        JSAMPROW row = out + stride * (flip ? cinfo.output_height - 1 - y : y);
+        jpeg_read_scanlines(&cinfo, &row, 1);
+    }
+    jpeg_finish_decompress(&cinfo);
+    *w = (int)cinfo.output_width;
+    *h = (int)cinfo.output_height;
+    *n = channels;
+    jpeg_destroy_decompress(&cinfo);
+    return out;
+}
+#endif
+
+#ifdef USE_LIBPNG
+static int isPng(const unsigned char* d, size_t size){ return size > 8 && memcmp(d, "\x89PNG\r\n\x1a\n", 8) == 0; }
+
+static unsigned char* decodeLibpng(const unsigned char* data, size_t size, int* w, int* h, int* n){
+    png_image image;
+    memset(&image, 0, sizeof(image));
+    image.version = PNG_IMAGE_VERSION;
+    if (!png_image_begin_read_from_memory(&image, data, size)) return NULL;
+    // Paleta expandida e 16 bits reduzidos para 8, como o stb entrega
+    image.format &= ~(png_uint_32)(PNG_FORMAT_FLAG_COLORMAP | PNG_FORMAT_FLAG_LINEAR);
+    int channels = (int)PNG_IMAGE_SAMPLE_CHANNELS(image.format);
+    png_int_32 stride = (png_int_32)PNG_IMAGE_ROW_STRIDE(image);
+    unsigned char* out = (unsigned char*)STBI_MALLOC(PNG_IMAGE_SIZE(image));
+    if (!out){ png_image_free(&image); return NULL; }
+    if (!png_image_finish_read(&image, NULL, out, stbi__vertically_flip_on_load ? -stride : stride, NULL)){
+        STBI_FREE(out);
+        png_image_free(&image);
+        return NULL;
+    }
+    *w = (int)image.width;
+    *h = (int)image.height;
+    *n = channels;
+    return out;
+}
+#endif
+
+typedef struct {
+    const char* name;
+    int (*accepts)(const unsigned char* data, size_t size);
+    unsigned char* (*decode)(const unsigned char* data, size_t size, int* w, int* h, int* n);   // NULL: passa adiante
+} ImageDecoder;
+
+// Ordem padrão de tentativa; o stb por último.
+static const ImageDecoder imageDecoders[] = {
+#ifdef USE_LIBJPEG
+    {"libjpeg",  isJpeg,   decodeLibjpeg},
+#endif
+#ifdef USE_LIBPNG
+    {"libpng",   isPng,    decodeLibpng},
+#endif
+    {"stb-rstn", isJpeg,   decodeJpegParallel},
+    {"stb",      anyImage, decodeStb},
+};
+#define IMAGE_DECODER_COUNT (int)(sizeof(imageDecoders) / sizeof(imageDecoders[0]))
+
+static int preferredDecoder = -1;
+
+int selectImageDecoder(const char* name){
+    for (int i = 0; i < IMAGE_DECODER_COUNT; ++i)
+        if (strcmp(imageDecoders[i].name, name) == 0){ preferredDecoder = i; return 1; }
+    printf("Decodificador desconhecido: %s (disponiveis:", name);
+    for (int i = 0; i < IMAGE_DECODER_COUNT; ++i) printf(" %s", imageDecoders[i].name);
+    printf(")\n");
+    return 0;
+}
+
+unsigned char* decodeImage(const unsigned char* data, size_t size, int* w, int* h, int* n){
+    const ImageDecoder* pref = preferredDecoder >= 0 ? &imageDecoders[preferredDecoder] : NULL;
+    if (pref && pref->accepts(data, size)){
+        unsigned char* pixels = pref->decode(data, size, w, h, n);
+        if (pixels) return pixels;
+    }
+    for (int i = 0; i < IMAGE_DECODER_COUNT; ++i){
+        const ImageDecoder* d = &imageDecoders[i];
+        if (d == pref || !d->accepts(data, size)) continue;
+        unsigned char* pixels = d->decode(data, size, w, h, n);
+        if (pixels) return pixels;
+    }
+    return NULL;
+}
+
+// Sem leitor incremental: percorre a imagem já decodificada.
+static const unsigned char* readDecodedScanlines(ScanlineSource* src, int count){
+    const unsigned char* rows = src->pixels + (size_t)src->next * src->w * src->n;
+    src->next += count;
+    return rows;
+}
+
+static void closeDecodedScanlines(ScanlineSource* src){ stbi_image_free(src->pixels); }
+
+#ifdef USE_LIBJPEG
+typedef struct {
+    struct jpeg_decompress_struct cinfo;
+    LibjpegError err;
+    unsigned char* rows;
+    int capacity;
+} LibjpegScanlines;
+
+static const unsigned char* readLibjpegScanlines(ScanlineSource* src, int count){
+    LibjpegScanlines* s = (LibjpegScanlines*)src->state;
+    size_t stride = (size_t)src->w * src->n;
+    if (count > s->capacity){
+        unsigned char* rows = (unsigned char*)realloc(s->rows, stride * count);
+        if (!rows) return NULL;
+        s->rows = rows;
+        s->capacity = count;
+    }
+    if (setjmp(s->err.env)) return NULL;   // arquivo truncado ou corrompido no meio
+    for (int i = 0; i < count; ++i){
+        JSAMPROW row = s->rows + stride * i;
+        if (jpeg_read_scanlines(&s->cinfo, &row, 1) != 1) return NULL;
+    }
+    return s->rows;
+}
+
+static void closeLibjpegScanlines(ScanlineSource* src){
+    LibjpegScanlines* s = (LibjpegScanlines*)src->state;
+    jpeg_destroy_decompress(&s->cinfo);
+    free(s->rows);
+    free(s);
+}
+
+static int openLibjpegScanlines(const unsigned char* data, size_t size, ScanlineSource* out){
+    LibjpegScanlines* s = (LibjpegScanlines*)calloc(1, sizeof(LibjpegScanlines));
+    if (!s) return 0;
+    s->cinfo.err = jpeg_std_error(&s->err.pub);
+    s->err.pub.error_exit = libjpegErrorExit;
+    s->err.pub.output_message = libjpegSilence;
+    if (setjmp(s->err.env)){
+        jpeg_destroy_decompress(&s->cinfo);
+        free(s);
+        return 0;   // decodeImage tenta os outros backends
+    }
+    jpeg_create_decompress(&s->cinfo);
+    jpeg_mem_src(&s->cinfo, (unsigned char*)data, (unsigned long)size);
+    jpeg_read_header(&s->cinfo, TRUE);
+    if (s->cinfo.jpeg_color_space == JCS_CMYK || s->cinfo.jpeg_color_space == JCS_YCCK) longjmp(s->err.env, 1);
+    s->cinfo.out_color_space = s->cinfo.num_components == 1 ? JCS_GRAYSCALE : JCS_RGB;
+    jpeg_start_decompress(&s->cinfo);
+    out->w = (int)s->cinfo.output_width;
+    out->h = (int)s->cinfo.output_height;
+    out->n = s->cinfo.output_components;
+    out->flipped = stbi__vertically_flip_on_load;
+    out->read = readLibjpegScanlines;
+    out->close = closeLibjpegScanlines;
+    out->state = s;
+    return 1;
+}
+#endif
+
+int openScanlines(const unsigned char* data, size_t size, ScanlineSource* out){
+    memset(out, 0, sizeof(*out));
+#ifdef USE_LIBJPEG
+    int libjpegAllowed = preferredDecoder < 0 || imageDecoders[preferredDecoder].decode == decodeLibjpeg;
+    if (libjpegAllowed && isJpeg(data, size) && openLibjpegScanlines(data, size, out)) return 1;
+#endif
+    out->pixels = decodeImage(data, size, &out->w, &out->h, &out->n);
+    if (!out->pixels) return 0;
+    out->read = readDecodedScanlines;
+    out->close = closeDecodedScanlines;
+    return 1;
+}
+
+// --- Benchmarks (sem janela) ---
+static const char* benchTextures[] = {
+    "assets/textures/sol.jpg",     "assets/textures/mercurio.jpg", "assets/textures/venus.jpg",
+    "assets/textures/terra.jpg",   "assets/textures/marte.jpg",    "assets/textures/jupiter.jpg",
+    "assets/textures/saturno.jpg", "assets/textures/urano.jpg",    "assets/textures/netuno.jpg",
+    "assets/textures/saturno_aneis.png", "assets/textures/estrelas.jpg",
+};
+#define BENCH_TEXTURE_COUNT (int)(sizeof(benchTextures) / sizeof(benchTextures[0]))
+
+static double psnrFromMSE(double mse){ return mse <= 0.0 ? 99.0 : 10.0 * log10(255.0 * 255.0 / mse); }
+
+// Codifica todas as texturas em BC1/BC3 (mips inclusos) e mede velocidade e PSNR do nível 0.
+int benchBlockCompression(void){
+    jobPoolStart(&workers, cpuCount());
+    initColorLUTs();
+    stbi_set_flip_vertically_on_load(1);
+    printf("BC1/BC3: %d threads, SSE2 %s\n", workers.threadCount,
+#ifdef USE_SSE2
+           "sim");
+#else
+           "nao");
+#endif
+    printf("%-34s %10s %4s %9s %8s %9s %8s %6s\n", "textura", "tamanho", "fmt", "ms", "MP/s", "PSNR rgb", "PSNR a", "razao");
+
+    for (int t = 0; t < BENCH_TEXTURE_COUNT; ++t){
+        int w, h, n;
+        unsigned char* pixels = stbi_load(benchTextures[t], &w, &h, &n, 0);
+        if (!pixels){ printf("Falha ao carregar textura: %s\n", benchTextures[t]); continue; }
+        size_t rawSize = 0, bcSize = 0;
+        unsigned char* raw = buildTexCache(pixels, w, h, n, 0, &rawSize);
+        stbi_image_free(pixels);
+
+        double t0 = nowSeconds();
+        unsigned char* bc = compressTexCache(raw, &bcSize);
+        double secs = nowSeconds() - t0;
+
+        const TexCacheHeader* rh = (const TexCacheHeader*)raw;
+        const TexCacheHeader* bh = (const TexCacheHeader*)bc;
+        double pixelsTotal = 0.0;
+        uint64_t rawBytes = 0, bcBytes = 0;
+        for (uint32_t i = 0; i < rh->levelCount; ++i){
+            pixelsTotal += (double)rh->levels[i].width * rh->levels[i].height;
+            rawBytes += rh->levels[i].size;
+            bcBytes  += bh->levels[i].size;
+        }
+
+        // Erro do nível 0: decodifica cada bloco e compara com o original
+        const unsigned char* src = raw + rh->levels[0].offset;
+        const unsigned char* blocks = bc + bh->levels[0].offset;
+        int blocksX = (w + 3) / 4, blocksY = (h + 3) / 4;
+        size_t blockBytes = bh->format == TEXFMT_BC3 ? 16 : 8;
+        double errRGB = 0.0, errA = 0.0;
+        unsigned char ref[64], dec[64];
+        for (int by = 0; by < blocksY; ++by){
+            for (int bx = 0; bx < blocksX; ++bx){
+                const unsigned char* blk = blocks + ((size_t)by * blocksX + bx) * blockBytes;
+                fetchBlock(src, w, h, n, bx, by, ref);
+                if (bh->format == TEXFMT_BC3) decodeBC3Block(blk, dec);
+                else                          decodeBC1Block(blk, dec, 0);
+                for (int y = 0; y < 4 && by * 4 + y < h; ++y){
+                    for (int x = 0; x < 4 && bx * 4 + x < w; ++x){
+                        const unsigned char* a = ref + (y * 4 + x) * 4;
+                        const unsigned char* b = dec + (y * 4 + x) * 4;
+                        for (int c = 0; c < 3; ++c) errRGB += (double)(a[c] - b[c]) * (a[c] - b[c]);
+                        errA += (double)(a[3] - b[3]) * (a[3] - b[3]);
+                    }
+                }
+            }
+        }
+        double count = (double)w * h;
+        char size[32], psnrA[16];
+        snprintf(size, sizeof(size), "%dx%d", w, h);
+        if (bh->format == TEXFMT_BC3) snprintf(psnrA, sizeof(psnrA), "%.2f", psnrFromMSE(errA / count));
+        else                          snprintf(psnrA, sizeof(psnrA), "-");
+        printf("%-34s %10s %4s %9.1f %8.1f %9.2f %8s %5.1fx\n", benchTextures[t], size,
+               bh->format == TEXFMT_BC3 ? "BC3" : "BC1", secs * 1000.0, pixelsTotal / secs / 1e6,
+               psnrFromMSE(errRGB / (count * 3.0)), psnrA, (double)rawBytes / (double)bcBytes);
+        free(raw);
+        free(bc);
+    }
+    jobPoolStop(&workers);
+    return 0;
+}
+
+// Mede a geração de mips na CPU para cada filtro e, se houver contexto GL (janela
+// oculta), o glGenerateMipmap do driver sobre o mesmo nível 0.
+int benchMipmaps(void){
+    jobPoolStart(&workers, cpuCount());
+    initColorLUTs();
+    stbi_set_flip_vertically_on_load(1);
+
+    GLFWwindow* hidden = NULL;
+    if (glfwInit()){
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        hidden = glfwCreateWindow(64, 64, "bench", NULL, NULL);
+        if (hidden){
+            glfwMakeContextCurrent(hidden);
+            if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)){ glfwDestroyWindow(hidden); hidden = NULL; }
+        }
+    }
+    printf("Mipmaps: %d threads, SSE2 %s, driver %s\n", workers.threadCount,
+#ifdef USE_SSE2
+           "sim",
+#else
+           "nao",
+#endif
+           hidden ? "sim" : "indisponivel");
+    printf("%-34s %10s %9s %9s %9s %9s\n", "textura", "tamanho", "box MP/s", "kaiser", "lanczos", "driver");
+
+    for (int t = 0; t < BENCH_TEXTURE_COUNT; ++t){
+        int w, h, n;
+        unsigned char* pixels = stbi_load(benchTextures[t], &w, &h, &n, 0);
+        if (!pixels){ printf("Falha ao carregar textura: %s\n", benchTextures[t]); continue; }
+        double rates[3];
+        MipFilter saved = mipFilter;
+        for (int f = 0; f < 3; ++f){
+            size_t size = 0;
+            mipFilter = (MipFilter)f;
+            double t0 = nowSeconds();
+            unsigned char* blob = buildTexCache(pixels, w, h, n, 0, &size);
+            double secs = nowSeconds() - t0;
+            const TexCacheHeader* hdr = (const TexCacheHeader*)blob;
+            double mp = 0.0;   // pixels gerados (níveis 1..N)
+            for (uint32_t i = 1; i < hdr->levelCount; ++i) mp += (double)hdr->levels[i].width * hdr->levels[i].height;
+            rates[f] = mp / secs / 1e6;
+            free(blob);
+        }
+        mipFilter = saved;
+
+        char size[32], driver[16];
+        snprintf(size, sizeof(size), "%dx%d", w, h);
+        snprintf(driver, sizeof(driver), "-");
+        if (hidden){
+            static const GLenum formats[] = {0, GL_RED, GL_RG, GL_RGB, GL_RGBA};
+            GLuint id;
+            glGenTextures(1, &id);
+            glBindTexture(GL_TEXTURE_2D, id);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            glTexImage2D(GL_TEXTURE_2D, 0, (GLint)formats[n], w, h, 0, formats[n], GL_UNSIGNED_BYTE, pixels);
+            glFinish();
+            double t0 = nowSeconds();
+            glGenerateMipmap(GL_TEXTURE_2D);
+            glFinish();
+            double secs = nowSeconds() - t0;
+            double mp = 0.0;
+            for (int lw = w, lh = h; lw > 1 || lh > 1; ){
+                lw = lw > 1 ? lw / 2 : 1; lh = lh > 1 ? lh / 2 : 1;
+                mp += (double)lw * lh;
+            }
+            snprintf(driver, sizeof(driver), "%.1f", mp / secs / 1e6);
+            glDeleteTextures(1, &id);
+        }
+        printf("%-34s %10s %9.1f %9.1f %9.1f %9s\n", benchTextures[t], size, rates[0], rates[1], rates[2], driver);
+        stbi_image_free(pixels);
+    }
+    if (hidden) glfwDestroyWindow(hidden);
+    glfwTerminate();
+    jobPoolStop(&workers);
+    return 0;
+}
+
+// Lê o arquivo inteiro em blocos, com IO_BENCH_DEPTH leituras em voo, em cada backend.
+#define IO_BENCH_BLOCK (256u * 1024u)
+#define IO_BENCH_DEPTH 32
+
+int benchAsyncIO(void){
+    const char* path = benchIoPath ? benchIoPath : PACK_FILE;
+    printf("E/S assincrona: %s, blocos de %u KB, %d leituras em voo\n", path, IO_BENCH_BLOCK / 1024u, IO_BENCH_DEPTH);
+    IoRequest  reqs[IO_BENCH_DEPTH];
+    IoRequest* batch[IO_BENCH_DEPTH];
+    IoQueue    done;
+    ioQueueInit(&done);
+    for (int i = 0; i < IO_BENCH_DEPTH; ++i){
+        memset(&reqs[i], 0, sizeof(reqs[i]));
+        reqs[i].dst = ioAllocAligned(IO_BENCH_BLOCK);
+        reqs[i].size = IO_BENCH_BLOCK;   // o último bloco passa do fim: leitura curta
+        reqs[i].done = &done;
+    }
+    int status = 0;
+
+    for (int b = IO_BACKEND_THREADS; b <= IO_BACKEND_URING && status == 0; ++b){
+        if (ioStart(b == IO_BACKEND_URING) != (IoBackend)b){
+            printf("%-9s indisponivel\n", ioBackendNames[b]);
+            ioStop();
+            continue;
+        }
+        IoFile f;
+        uint64_t size = 0;
+        int opened = ioOpen(path, 1, &f, &size);
+        if (!opened){ printf("Falha ao abrir %s\n", path); ioStop(); status = 1; break; }
+
+        uint64_t next = 0, bytes = 0;
+        int inflight = 0, errors = 0;
+        double t0 = nowSeconds();
+        for (int i = 0; i < IO_BENCH_DEPTH && next < size; ++i, next += IO_BENCH_BLOCK){
+            reqs[i].file = f;
+            reqs[i].offset = next;
+            batch[inflight++] = &reqs[i];
+        }
+        ioSubmit(batch, inflight);
+        while (inflight > 0){
+            IoRequest* r = ioQueuePop(&done, 1);
+            inflight--;
+            if (r->result < 0) errors++; else bytes += (uint64_t)r->result;
+            if (next < size){   // o bloco volta para a fila com o próximo offset
+                r->offset = next;
+                next += IO_BENCH_BLOCK;
+                ioSubmit(&r, 1);
+                inflight++;
+            }
+        }
+        double secs = nowSeconds() - t0;
+        ioClose(f);
+        ioStop();
+        printf("%-9s O_DIRECT %-3s %8.1f MB em %6.3f s: %8.1f MB/s%s\n", ioBackendNames[b], opened == 2 ? "sim" : "nao",
+               bytes / 1e6, secs, bytes / 1e6 / (secs > 0.0 ? secs : 1e-9), errors ? " (com erros de leitura)" : "");
+        if (errors || bytes != size) status = 1;
+    }
+    for (int i = 0; i < IO_BENCH_DEPTH; ++i) ioFreeAligned(reqs[i].dst);
+    return status;
+}
+
+// stb_image sozinho x decodeImage (RSTn em paralelo), melhor de 3, e confere os pixels.
+static void benchJpegFile(const char* path){
+    MappedFile mf;
+    if (!mapFile(path, &mf)){ printf("Falha ao carregar textura: %s\n", path); return; }
+    double best[2] = {1e30, 1e30};
+    unsigned char* result[2] = {NULL, NULL};
+    int w = 0, h = 0, n = 0, parallel = 0;
+    for (int rep = 0; rep < 3; ++rep){
+        for (int mode = 0; mode < 2; ++mode){
+            double t0 = nowSeconds();
+            unsigned char* pixels = mode == 0 ? stbi_load_from_memory(mf.data, (int)mf.size, &w, &h, &n, 0)
+                                              : decodeJpegParallel(mf.data, mf.size, &w, &h, &n);
+            double secs = nowSeconds() - t0;
+            if (mode == 1 && !pixels){   // sem RSTn: decodeImage cairia no stb
+                pixels = stbi_load_from_memory(mf.data, (int)mf.size, &w, &h, &n, 0);
+                secs = nowSeconds() - t0;
+            } else if (mode == 1) parallel = 1;
+            if (secs < best[mode]) best[mode] = secs;
+            if (result[mode]) stbi_image_free(result[mode]);
+            result[mode] = pixels;
+        }
+    }
+    char size[32];
+    snprintf(size, sizeof(size), "%dx%d", w, h);
+    int same = result[0] && result[1] && memcmp(result[0], result[1], (size_t)w * h * n) == 0;
+    printf("%-34s %10s %9.1f %9.1f %7.2fx  %-9s %s\n", path, size, best[0] * 1e3, best[1] * 1e3, best[0] / best[1],
+           parallel ? "RSTn" : "stb", same ? "identicos" : "DIFERENTES");
+    stbi_image_free(result[0]);
+    stbi_image_free(result[1]);
+    unmapFile(&mf);
+}
+
+int benchJpegDecode(void){
+    jobPoolStart(&workers, cpuCount());
+    stbi_set_flip_vertically_on_load(1);
+    printf("JPEG: %d threads (arquivos sem restart markers vao inteiros para o stb)\n", workers.threadCount);
+    printf("%-34s %10s %9s %9s %8s  %-9s %s\n", "textura", "tamanho", "stb ms", "paralelo", "ganho", "caminho", "pixels");
+    for (int t = 0; t < BENCH_TEXTURE_COUNT; ++t){
+        size_t len = strlen(benchTextures[t]);
+        if (len > 4 && strcmp(benchTextures[t] + len - 4, ".jpg") == 0) benchJpegFile(benchTextures[t]);
+    }
+    if (benchJpegPath) benchJpegFile(benchJpegPath);
+    jobPoolStop(&workers);
+    return 0;
+}
+
+// Pico de memória residente durante uma chamada (Linux: zera o VmHWM via clear_refs).
+#if defined(__linux__)
+static long procStatusKB(const char* key){
+    FILE* f = fopen("/proc/self/status", "r");
+    if (!f) return -1;
+    char line[256];
+    long kb = -1;
+    size_t len = strlen(key);
+    while (fgets(line, sizeof(line), f))
+        if (strncmp(line, key, len) == 0 && line[len] == ':'){ kb = strtol(line + len + 1, NULL, 10); break; }
+    fclose(f);
+    return kb;
+}
+
+static long peakMemoryReset(void){
+#ifdef __GLIBC__
+    malloc_trim(0);   // devolve o que sobrou das decodificações anteriores
+#endif
+    FILE* f = fopen("/proc/self/clear_refs", "w");
+    if (!f) return -1;
+    int ok = fputs("5", f) >= 0;
+    ok = (fclose(f) == 0) && ok;
+    return ok ? procStatusKB("VmRSS") : -1;
+}
+
+static long peakMemorySince(long baseKB){ return baseKB < 0 ? -1 : procStatusKB("VmHWM") - baseKB; }
+#else
+static long peakMemoryReset(void){ return -1; }
+static long peakMemorySince(long baseKB){ (void)baseKB; return -1; }
+#endif
+
+typedef struct { int count; char paths[64][300]; } FileList;
+
+static void collectFile(const char* path, void* ctx){
+    FileList* list = (FileList*)ctx;
+    if (list->count < 64) snprintf(list->paths[list->count++], sizeof(list->paths[0]), "%s", path);
+}
+
+static int comparePaths(const void* a, const void* b){ return strcmp((const char*)a, (const char*)b); }
+
+// Cada arquivo de assets/textures com cada backend que o aceita: MB/s de pixels
+// decodificados (melhor de 3), pico de memória residente e diferença máxima para o stb.
+int benchDecoders(void){
+    jobPoolStart(&workers, cpuCount());
+    stbi_set_flip_vertically_on_load(1);
+    FileList* files = (FileList*)calloc(1, sizeof(FileList));
+    listFiles("assets/textures", collectFile, files);
+    qsort(files->paths, (size_t)files->count, sizeof(files->paths[0]), comparePaths);
+    printf("Decodificadores: %d threads, %d arquivos; MB/s de pixels decodificados, pico = memoria residente\n",
+           workers.threadCount, files->count);
+    printf("%-34s %10s %-9s %9s %9s %8s\n", "arquivo", "tamanho", "backend", "MB/s", "pico MB", "dif. stb");
+
+    for (int f = 0; f < files->count; ++f){
+        MappedFile mf;
+        if (!mapFile(files->paths[f], &mf)) continue;
+        (void)hashBytes(mf.data, mf.size, HASH_SEED);   // páginas do arquivo fora da medida
+        int rw = 0, rh = 0, rn = 0;
+        unsigned char* reference = decodeStb(mf.data, mf.size, &rw, &rh, &rn);
+        if (!reference){ printf("%-34s nao decodificou\n", files->paths[f]); unmapFile(&mf); continue; }
+
+        for (int d = 0; d < IMAGE_DECODER_COUNT; ++d){
+            const ImageDecoder* dec = &imageDecoders[d];
+            if (!dec->accepts(mf.data, mf.size)) continue;
+            int w, h, n;
+            long base = peakMemoryReset();
+            unsigned char* pixels = dec->decode(mf.data, mf.size, &w, &h, &n);
+            long peakKB = peakMemorySince(base);
+            if (!pixels){
+                printf("%-34s %10s %-9s %9s\n", files->paths[f], "", dec->name, "-");
+                continue;
+            }
+            int diff = -1;   // canais diferentes do stb: não compara
+            if (w == rw && h == rh && n == rn){
+                diff = 0;
+                for (size_t i = 0; i < (size_t)w * h * n; ++i){
+                    int e = abs((int)pixels[i] - (int)reference[i]);
+                    if (e > diff) diff = e;
+                }
+            }
+            stbi_image_free(pixels);
+
+            double best = 1e30;
+            for (int rep = 0; rep < 3; ++rep){
+                double t0 = nowSeconds();
+                pixels = dec->decode(mf.data, mf.size, &w, &h, &n);
+                double secs = nowSeconds() - t0;
+                stbi_image_free(pixels);
+                if (secs < best) best = secs;
+            }
+            char size[32], peak[16], dif[16];
+            snprintf(size, sizeof(size), "%dx%dx%d", w, h, n);
+            snprintf(peak, sizeof(peak), peakKB >= 0 ? "%.1f" : "-", peakKB / 1024.0);
+            snprintf(dif, sizeof(dif), diff >= 0 ? "%d" : "-", diff);
+            printf("%-34s %10s %-9s %9.1f %9s %8s\n", files->paths[f], size, dec->name,
+                   (double)w * h * n / best / 1e6, peak, dif);
+        }
+        stbi_image_free(reference);
+        unmapFile(&mf);
+    }
+    free(files);
+    jobPoolStop(&workers);
+    return 0;
+}
+
+// --bench-noise: geração das texturas procedurais em ms por megapixel, com o
+// glm_perlin_vec3 ponto a ponto (1 thread), o lote SSE2 (1 thread) e o lote nos
+// workers; "dif" é a maior diferença (0-255) entre o lote e a referência.
+int benchNoise(void){
+    jobPoolStart(&workers, cpuCount());
+    printf("Ruido: %d threads, SSE2 %s\n", workers.threadCount,
+#ifdef USE_SSE2
+           "sim"
+#else
+           "nao"
+#endif
+           );
+    printf("%-10s %10s %10s %10s %10s %5s\n", "textura", "tamanho", "escalar", "lote", "lote+thr", "dif");
+    static const struct { const char* name; const ProceduralParams* params; } cases[] = {
+        {"sol", &procSun}, {"jupiter", &procJupiter}, {"netuno", &procNeptune},
+    };
+    for (int c = 0; c < (int)(sizeof(cases) / sizeof(cases[0])); ++c){
+        int w = (int)cases[c].params->width, h = w / 2;
+        size_t size = (size_t)w * h * 3;
+        unsigned char* reference = (unsigned char*)malloc(size);
+        unsigned char* pixels = (unsigned char*)malloc(size);
+        if (!reference || !pixels){ free(reference); free(pixels); continue; }
+        double mp = (double)w * h / 1e6, ms[3];
+        for (int mode = 0; mode < 3; ++mode){
+            procScalarNoise = mode == 0;
+            double t0 = nowSeconds();
+            procGenerate(cases[c].params, mode == 0 ? reference : pixels, w, h, mode == 2);
+            ms[mode] = (nowSeconds() - t0) * 1000.0 / mp;
+        }
+        procScalarNoise = 0;
+        int diff = 0;
+        for (size_t i = 0; i < size; ++i){
+            int e = abs((int)pixels[i] - (int)reference[i]);
+            if (e > diff) diff = e;
+        }
+        char dims[32];
+        snprintf(dims, sizeof(dims), "%dx%d", w, h);
+        printf("%-10s %10s %7.1f ms %7.1f ms %7.1f ms %5d   (por MP)\n", cases[c].name, dims, ms[0], ms[1], ms[2], diff);
+        free(reference);
+        free(pixels);
+    }
+    jobPoolStop(&workers);
+    return 0;
+}
+
+// Passe de transformações: composição genérica (glm_rotate + inversa, como era o
+// draw_planet) contra o laço SoA, sem e com workers, para 10k/100k/1M corpos. A
+// diferença máxima é medida nas três saídas (model, normal e mvp) contra o cglm.
+int benchTransforms(void){
+    jobPoolStart(&workers, cpuCount());
+    printf("Transformacoes: %d threads\n", workers.threadCount);
+    printf("%-9s %12s %12s %12s %9s %9s %9s\n", "corpos", "generico", "lote", "lote+thr", "dif model", "normal", "mvp");
+    static const int counts[] = {10000, 100000, 1000000};
+    mat4 projection, view, viewProj;
+    glm_perspective(glm_rad(45.0f), 16.0f / 9.0f, 0.1f, 200.0f, projection);
+    glm_lookat((vec3){0.0f, 20.0f, 40.0f}, (vec3){0.0f, 0.0f, 0.0f}, (vec3){0.0f, 1.0f, 0.0f}, view);
+    glm_mat4_mul(projection, view, viewProj);
+    const float t = 12.5f;
+    for (int c = 0; c < (int)(sizeof(counts) / sizeof(counts[0])); ++c){
+        int n = counts[c];
+        BodyTransforms xf;
+        initBodyTransforms(&xf, n);
+        mat4* refModel  = (mat4*)ioAllocAligned((size_t)n * sizeof(mat4));
+        mat4* refMvp    = (mat4*)ioAllocAligned((size_t)n * sizeof(mat4));
+        mat3* refNormal = (mat3*)malloc((size_t)n * sizeof(mat3));
+        float* incl = (float*)malloc((size_t)n * sizeof(float));   // o genérico gira pelo ângulo, não pelo cosseno
+        if (!xf.model || !xf.mvp || !xf.normal || !refModel || !refMvp || !refNormal || !incl){
+            freeBodyTransforms(&xf); ioFreeAligned(refModel); ioFreeAligned(refMvp); free(refNormal); free(incl);
+            continue;
+        }
+        uint32_t seed = 0x9e3779b9u;
+        for (int i = 0; i < n; ++i){
+            float r[6];
+            for (int j = 0; j < 6; ++j){ seed = seed * 1664525u + 1013904223u; r[j] = (float)(seed >> 8) / 16777216.0f; }
+            incl[i] = glm_rad(10.0f * r[2]);
+            addBody(&xf, 1.0f + 60.0f * r[0], 5.0f + 50.0f * r[1], 10.0f * r[2], 30.0f * r[3],
+                    -300.0f + 600.0f * r[4], 0.1f + r[5]);
+        }
+
+        double best[3] = {1e30, 1e30, 1e30};   // genérico, lote, lote+thr: melhor de 3 (a 1ª passada paga as page faults)
+        for (int run = 0; run < 3; ++run){
+            double t0 = nowSeconds();
+            for (int i = 0; i < n; ++i){
+                mat4 orbit, local;
+                mat3 linear;
+                glm_mat4_identity(orbit);
+                glm_rotate(orbit, incl[i], (vec3){1.0f, 0.0f, 0.0f});
+                float ang = t * xf.orbitRate[i];
+                glm_translate(orbit, (vec3){cosf(ang) * xf.orbitRadius[i], 0.0f, sinf(ang) * xf.orbitRadius[i]});
+                glm_mat4_identity(local);
+                glm_rotate(local, glm_rad(90.0f), (vec3){1.0f, 0.0f, 0.0f});
+                glm_rotate(local, xf.spinPhase[i], (vec3){0.0f, 0.0f, 1.0f});
+                glm_rotate(local, t * xf.spinRate[i], (vec3){0.0f, 0.0f, 1.0f});
+                glm_scale(local, (vec3){xf.scale[i], xf.scale[i], xf.scale[i]});
+                glm_mul(orbit, local, refModel[i]);
+                glm_mat4_mul(viewProj, refModel[i], refMvp[i]);
+                glm_mat4_pick3(refModel[i], linear);
+                glm_mat3_inv(linear, refNormal[i]);
+                glm_mat3_transpose(refNormal[i]);
+            }
+            double t1 = nowSeconds();
+            TransformJob job;
+            job.xf = &xf;
+            job.t = t;
+            glm_mat4_copy(viewProj, job.viewProj);
+            transformRange(&job, 0, n);
+            double t2 = nowSeconds();
+            updateBodyTransforms(&xf, t, viewProj);
+            double t3 = nowSeconds();
+            best[0] = fmin(best[0], t1 - t0);
+            best[1] = fmin(best[1], t2 - t1);
+            best[2] = fmin(best[2], t3 - t2);
+        }
+
+        float diff[3] = {0.0f, 0.0f, 0.0f};   // model, normal, mvp
+        for (int i = 0; i < n; ++i){
+            for (int j = 0; j < 16; ++j){
+                diff[0] = fmaxf(diff[0], fabsf(xf.model[i][j / 4][j % 4] - refModel[i][j / 4][j % 4]));
+                diff[2] = fmaxf(diff[2], fabsf(xf.mvp[i][j / 4][j % 4] - refMvp[i][j / 4][j % 4]));
+            }
+            for (int j = 0; j < 9; ++j)
+                diff[1] = fmaxf(diff[1], fabsf(xf.normal[i][j / 3][j % 3] - refNormal[i][j / 3][j % 3]));
+        }
+        printf("%-9d %9.1f ns %9.1f ns %9.1f ns %9.2g %9.2g %9.2g   (por corpo)\n", n,
+               best[0] * 1e9 / n, best[1] * 1e9 / n, best[2] * 1e9 / n, diff[0], diff[1], diff[2]);
+        ioFreeAligned(refModel);
+        ioFreeAligned(refMvp);
+        free(refNormal);
+        free(incl);
+        freeBodyTransforms(&xf);
+    }
+    jobPoolStop(&workers);
+    return 0;
 }